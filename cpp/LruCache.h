@@ -0,0 +1,112 @@
+#pragma once
+
+#include <list>
+#include <mutex>
+#include <utility>
+#include <functional>
+#include <optional>
+#include <unordered_map>
+
+/// Thread-safe key-value cache which holds entries up to a size budget (typically bytes).
+/// If the budget is exceeded, the least recently used entries are evicted.
+/// \tparam Key type of keys, must be hashable
+/// \tparam Value type of values, should be cheap to copy (e.g. std::shared_ptr)
+template<typename Key, typename Value>
+class LruCache {
+    using Entry = std::pair<Key, Value>;
+
+    mutable std::mutex mutex;
+    std::list<Entry> entries; // most recently used first
+    std::unordered_map<Key, typename std::list<Entry>::iterator> entryByKey;
+    std::function<size_t(Value const &)> sizeOf;
+    size_t budget;
+    size_t totalSize = 0;
+
+    size_t hitCount = 0, missCount = 0, evictionCount = 0;
+
+    void evictOverBudget() {
+        while (totalSize > budget && !entries.empty()) {
+            totalSize -= sizeOf(entries.back().second);
+            entryByKey.erase(entries.back().first);
+            entries.pop_back();
+            ++evictionCount;
+        }
+    }
+
+public:
+    /// \param budget maximum total size of values, 0 disables the cache
+    /// \param size_of returns the size of a value
+    LruCache(size_t budget, std::function<size_t(Value const &)> size_of)
+            : sizeOf(std::move(size_of)), budget(budget) {}
+
+    bool enabled() const {
+        return budget != 0;
+    }
+
+    /// Find the value of key and mark it as recently used.
+    /// \param usable an entry is only returned (and counted as hit) if it satisfies this predicate
+    /// \return the value or std::nullopt on miss
+    std::optional<Value> find(Key const &key, std::function<bool(Value const &)> const &usable = nullptr) {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        auto iterator = entryByKey.find(key);
+        if (iterator == entryByKey.end() || (usable && !usable(iterator->second->second))) {
+            ++missCount;
+            return std::nullopt;
+        }
+
+        ++hitCount;
+        entries.splice(entries.begin(), entries, iterator->second);
+        return iterator->second->second;
+    }
+
+    /// Insert or replace the value of key. Values larger than the whole budget are not stored.
+    void insert(Key const &key, Value value) {
+        size_t value_size = sizeOf(value);
+
+        std::lock_guard<std::mutex> lock{mutex};
+        auto iterator = entryByKey.find(key);
+        if (iterator != entryByKey.end()) {
+            totalSize -= sizeOf(iterator->second->second);
+            entries.erase(iterator->second);
+            entryByKey.erase(iterator);
+        }
+
+        if (value_size > budget)
+            return;
+
+        entries.emplace_front(key, std::move(value));
+        entryByKey.emplace(key, entries.begin());
+        totalSize += value_size;
+        evictOverBudget();
+    }
+
+    /// Calls function with each key and value, least recently used first, so inserting them in this order
+    /// into another cache keeps their recency.
+    template<typename Function>
+    void forEach(Function function) const {
+        std::lock_guard<std::mutex> lock{mutex};
+        for (auto it = entries.rbegin(); it != entries.rend(); ++it)
+            function(it->first, it->second);
+    }
+
+    size_t hits() const {
+        std::lock_guard<std::mutex> lock{mutex};
+        return hitCount;
+    }
+
+    size_t misses() const {
+        std::lock_guard<std::mutex> lock{mutex};
+        return missCount;
+    }
+
+    size_t evictions() const {
+        std::lock_guard<std::mutex> lock{mutex};
+        return evictionCount;
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock{mutex};
+        return totalSize;
+    }
+};
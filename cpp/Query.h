@@ -1,11 +1,16 @@
 #pragma once
 
+#include <algorithm>
 #include <chrono>
+#include <iostream>
+#include <optional>
+#include <sstream>
 #include <utility>
 #include <memory>
 #include "input.h"
 #include "BaseQuery.h"
 #include "gb_utils.h"
+#include "trace.h"
 
 template<typename... ParameterT>
 class Query : public BaseQuery {
@@ -19,6 +24,70 @@ protected:
 
     virtual std::tuple<std::string, std::string> initial_calculation() = 0;
 
+    /// k of top-k queries, which is their first parameter
+    virtual std::optional<uint64_t> resultLimit() const {
+        return std::nullopt;
+    }
+
+    /// Options changing the result besides the parameters, part of the result cache key.
+    virtual std::string resultOptions() const {
+        return "";
+    }
+
+private:
+    /// Result of the first k entries (separated by spaces) of a cached result,
+    /// std::nullopt if it might have less entries than needed or its entries cannot be told apart.
+    static std::optional<std::tuple<std::string, std::string>> first_entries(QueryResult const &cached, uint64_t k) {
+        if (cached.k == k || cached.result.empty())
+            return std::make_tuple(cached.result, cached.comment);
+        if (cached.k == 0 || k == 0)
+            return std::nullopt;
+
+        // the comment holds a score for each entry, names of the result might contain spaces
+        size_t entries = std::count(cached.result.begin(), cached.result.end(), ' ') + 1;
+        if (size_t(std::count(cached.comment.begin(), cached.comment.end(), ' ') + 1) != entries)
+            return std::nullopt;
+        if (k > cached.k && entries >= cached.k)
+            return std::nullopt;
+        if (entries <= k)
+            return std::make_tuple(cached.result, cached.comment);
+
+        auto prefix = [k](std::string const &entries_str) {
+            size_t end = 0;
+            for (uint64_t i = 0; i < k; ++i)
+                end = entries_str.find(' ', end + (i != 0));
+            return entries_str.substr(0, end);
+        };
+        return std::make_tuple(prefix(cached.result), prefix(cached.comment));
+    }
+
+    std::tuple<std::string, std::string> cached_calculation() {
+        auto &cache = input.caches.queryResults;
+        if (!cache.enabled())
+            return initial_calculation();
+
+        std::string key = resultCacheKey();
+        uint64_t k = resultLimit().value_or(0);
+        std::optional<std::tuple<std::string, std::string>> result_tuple;
+        cache.find(key, [&](auto const &value) {
+            result_tuple = first_entries(*value, k);
+            return result_tuple.has_value();
+        });
+        if (!result_tuple) {
+            result_tuple = initial_calculation();
+            auto const &[result, comment] = *result_tuple;
+            cache.insert(key, std::make_shared<QueryResult const>(QueryResult{k, result, comment}));
+        }
+
+        if (benchmarkParameters.PrintStats)
+            std::cerr << "Result cache: hits: " << cache.hits()
+                      << ", misses: " << cache.misses()
+                      << ", evictions: " << cache.evictions()
+                      << ", bytes: " << cache.size() << std::endl;
+
+        return *result_tuple;
+    }
+
 public:
     Query(BenchmarkParameters const &benchmark_parameters, ParameterType queryParams, QueryInput const &input)
             : benchmarkParameters{benchmark_parameters}, queryParams{std::move(queryParams)}, input(input) {}
@@ -27,11 +96,40 @@ public:
         using namespace std::chrono;
         auto initial_start = high_resolution_clock::now();
 
-        auto result_tuple = initial_calculation();
+        std::tuple<std::string, std::string> result_tuple;
+        try {
+            DeadlineScope deadline{benchmarkParameters.QueryTimeout == 0
+                                   ? steady_clock::time_point::max()
+                                   : steady_clock::now() + milliseconds{benchmarkParameters.QueryTimeout}};
+            TRACE_SCOPE("q" + std::to_string(getQueryId()), parametersString(false));
+            result_tuple = cached_calculation();
+        } catch (QueryTimeoutError const &) {
+            // objects of the query have been freed while unwinding
+            result_tuple = {"timeout", "Exceeded " + std::to_string(benchmarkParameters.QueryTimeout) + " ms"};
+        }
 
         report_result(*this, benchmarkParameters, round<nanoseconds>(high_resolution_clock::now() - initial_start),
                       result_tuple);
 
         return result_tuple;
     }
+
+    /// Parameters separated by '|'.
+    /// \param skip_limit omit the first parameter, k of top-k queries
+    std::string parametersString(bool skip_limit) const {
+        std::ostringstream str;
+        std::apply([&](auto const &... params) {
+            size_t const first = skip_limit ? 2 : 1;
+            size_t i = 0;
+            ((i++ == 0 && skip_limit ? void() : void(str << (i == first ? "" : "|") << params)), ...);
+        }, queryParams);
+        return str.str();
+    }
+
+    /// Query ID, parameters, except k of top-k queries: their results answer smaller k too, and result options.
+    std::string resultCacheKey() const {
+        std::string options = resultOptions();
+        return 'q' + std::to_string(getQueryId()) + '|' + parametersString(resultLimit().has_value()) +
+               (options.empty() ? "" : '|' + options);
+    }
 };
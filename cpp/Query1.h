@@ -26,9 +26,11 @@ class Query1 : public Query<uint64_t, uint64_t, int> {
         GrB_Matrix A;
         GBxx_Object<GrB_Matrix> personToPerson;
 
+        TRACE_PHASES();
         if (comment_lower_limit == -1) {
             A = input.knows.matrix.get();
         } else {
+            TRACE_PHASE("q1 comment graph");
             GBxx_Object<GrB_Matrix> personAToComment2 = GB(GrB_Matrix_new, GrB_UINT64, input.persons.size(),
                                                            input.comments.size());
 
@@ -58,6 +60,7 @@ class Query1 : public Query<uint64_t, uint64_t, int> {
         ok(GxB_Matrix_fprint(A, "personToPersonFiltered", GxB_SUMMARY, stdout));
 #endif
 
+        TRACE_PHASE("q1 BFS");
         int distance;
 
         GrB_Index n;
@@ -75,6 +78,7 @@ class Query1 : public Query<uint64_t, uint64_t, int> {
 
         // use two "push" frontiers
         for (GrB_Index level = 1; level < n / 2 + 1; level++) {
+            check_deadline();
             ok(GrB_vxm(next1.get(), seen1.get(), NULL, GxB_ANY_PAIR_BOOL, next1.get(), A, GrB_DESC_RSC));
 
             GrB_Index next1nvals;
@@ -22,6 +22,8 @@ class Query2 : public Query<int, std::string> {
         GrB_Type GB_TIME_T = GrB_INT64;
         static_assert(std::is_same<time_t, int64_t>::value);
 
+        TRACE_PHASES();
+        TRACE_PHASE("q2 birthdays");
         // store scalar parameter
         GBxx_Object<GxB_Scalar> birthday_limit = GB(GxB_Scalar_new, GB_TIME_T);
         ok(GxB_Scalar_setElement_INT64(birthday_limit.get(), parseTimestamp(birthday_limit_str.c_str(), DateFormat)));
@@ -50,14 +52,29 @@ class Query2 : public Query<int, std::string> {
 
         auto tag_scores = makeSmallestElementsContainer<tag_score_type>(top_k_limit, comparator);
 
-#pragma omp parallel num_threads(GlobalNThreads)
+        // each interest is processed once
+        GrB_Index interests_nvals;
+        ok(GrB_Matrix_nvals(&interests_nvals, input.hasInterestTran.matrix.get()));
+        int nthreads = phase_threads(benchmarkParameters, "Q2 tags", interests_nvals);
+        // the deadline of the query holds for the other threads too
+        auto deadline = QueryDeadline;
+        TRACE_PHASE("q2 tags");
+#pragma omp parallel num_threads(nthreads)
         {
+            TRACE_SCOPE("q2 tags of thread");
+            DeadlineScope deadline_scope{deadline};
+            // each thread extracts its induced subgraphs alone
+            ThreadsScope threads{1};
             auto tag_scores_local = makeSmallestElementsContainer<tag_score_type>(top_k_limit, comparator);
             GBxx_Object<GrB_Vector> interested_person_vec = GB(GrB_Vector_new, GrB_BOOL,
                                                                input.personsWithBirthdays.size());
 
 #pragma omp for schedule(dynamic)
             for (int tag_index = 0; tag_index < input.tags.size(); ++tag_index) {
+                // skip the remaining tags, the timeout is thrown after the parallel region
+                if (deadline_passed())
+                    continue;
+
                 ok(GrB_Col_extract(interested_person_vec.get(), birthday_person_mask.get(), GrB_NULL,
                                    input.hasInterestTran.matrix.get(), GrB_ALL, 0, tag_index,
                                    GrB_DESC_RST0));
@@ -73,13 +90,9 @@ class Query2 : public Query<int, std::string> {
                                                      interested_person_vec.get()));
                     assert(interested_person_nvals == nvals_out);
 
-                    GBxx_Object<GrB_Matrix> knows_subgraph = GB(GrB_Matrix_new, GrB_BOOL, interested_person_nvals,
-                                                                interested_person_nvals);
-
-                    ok(GrB_Matrix_extract(knows_subgraph.get(), GrB_NULL, GrB_NULL, input.knows.matrix.get(),
-                                          interested_person_indices.data(), interested_person_nvals,
-                                          interested_person_indices.data(), interested_person_nvals,
-                                          GrB_NULL));
+                    // indices are sorted
+                    GBxx_Object<GrB_Matrix> knows_subgraph =
+                            input.knowsGraph.inducedSubgraph(interested_person_indices).toMatrix();
 
                     // assuming that all component_ids will be in [0, n)
                     GrB_Matrix knows_subgraph_owning_ptr = knows_subgraph.release();
@@ -110,7 +123,9 @@ class Query2 : public Query<int, std::string> {
                 tag_scores.add(score);
             }
         }
+        check_deadline();
 
+        TRACE_PHASE("q2 result");
         std::string result, comment;
         bool firstIter = true;
         for (auto const &[score, tag_name]: tag_scores.removeElements()) {
@@ -128,6 +143,10 @@ class Query2 : public Query<int, std::string> {
         return {result, comment};
     }
 
+    std::optional<uint64_t> resultLimit() const override {
+        return top_k_limit;
+    }
+
 public:
     int getQueryId() const override {
         return 2;
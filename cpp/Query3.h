@@ -8,6 +8,8 @@
 #include <set>
 #include <cstdio>
 #include <utility>
+#include <limits>
+#include <omp.h>
 #include "utils.h"
 #include "Query.h"
 #include <cstdio>
@@ -21,57 +23,41 @@ class Query3 : public Query<int, int, std::string> {
     GBxx_Object<GrB_Vector> getRelevantPersons() {
         GrB_Index place_index = input.places.findIndexByName(placeName);
 
-        // set starting place
-        auto selected_places = GB(GrB_Vector_new, GrB_BOOL, input.places.size());
-        ok(GrB_Vector_setElement_BOOL(selected_places.get(), true, place_index));
-
-        auto selected_organizations = GB(GrB_Vector_new, GrB_BOOL, input.organizations.size());
+        // persons of the place hierarchy are precomputed at load time
+        GrB_Index relevant_persons_nvals = input.placeRelevantPersons.size(place_index);
         auto relevant_persons = GB(GrB_Vector_new, GrB_BOOL, input.persons.size());
-
-        Places::Type place_type = input.places.types[place_index];
-        while (true) {
-            switch (place_type) {
-                case Places::Continent:
-                    // no person to reach from the continent
-                    break;
-                case Places::Country:
-                    // get companies
-                    ok(GrB_vxm(selected_organizations.get(), GrB_NULL, GrB_NULL, GxB_ANY_PAIR_BOOL,
-                               selected_places.get(), input.organizationIsLocatedInPlaceTran.matrix.get(), GrB_NULL));
-                    // get persons working at companies
-                    ok(GrB_vxm(relevant_persons.get(), GrB_NULL, GrB_NULL, GxB_ANY_PAIR_BOOL,
-                               selected_organizations.get(), input.workAtTran.matrix.get(), GrB_NULL));
-                    break;
-                case Places::City:
-                    // get universities
-                    ok(GrB_vxm(selected_organizations.get(), GrB_NULL, GrB_NULL, GxB_ANY_PAIR_BOOL,
-                               selected_places.get(), input.organizationIsLocatedInPlaceTran.matrix.get(), GrB_NULL));
-                    // add persons studying at universities
-                    ok(GrB_vxm(relevant_persons.get(), GrB_NULL, GxB_PAIR_BOOL, GxB_ANY_PAIR_BOOL,
-                               selected_organizations.get(), input.studyAtTran.matrix.get(), GrB_NULL));
-
-                    // add persons at cities
-                    ok(GrB_vxm(relevant_persons.get(), GrB_NULL, GxB_PAIR_BOOL, GxB_ANY_PAIR_BOOL,
-                               selected_places.get(), input.personIsLocatedInCityTran.matrix.get(), GrB_NULL));
-                    break;
-                default:
-                    throw std::runtime_error("Unknown Place.type");
-            }
-
-            // get parts of current places (overwriting current ones)
-            if (place_type < Places::City) {
-                ok(GrB_vxm(selected_places.get(), GrB_NULL, GrB_NULL,
-                           GxB_ANY_PAIR_BOOL, selected_places.get(), input.isPartOfTran.matrix.get(), GrB_NULL));
-                ++place_type;
-            } else
-                break;
-        }
+        ok(GrB_Vector_build_BOOL(relevant_persons.get(), input.placeRelevantPersons.personsOf(place_index),
+                                 array_of_true(relevant_persons_nvals).get(), relevant_persons_nvals, GrB_LOR));
 
         return relevant_persons;
     }
 
     using score_type = std::tuple<int64_t, uint64_t, uint64_t>;
 
+    static std::vector<GrB_Index> extract_indices(GrB_Vector vector) {
+        GrB_Index vector_nvals;
+        ok(GrB_Vector_nvals(&vector_nvals, vector));
+
+        std::vector<GrB_Index> indices(vector_nvals);
+        {
+            GrB_Index nvals = vector_nvals;
+            ok(GrB_Vector_extractTuples_BOOL(indices.data(), GrB_NULL, &nvals, vector));
+            assert(vector_nvals == nvals);
+        }
+        return indices;
+    }
+
+    /// Build a diagonal matrix of the given persons, e.g. the first frontier of MSBFS.
+    GBxx_Object<GrB_Matrix> persons_diagonal(std::vector<GrB_Index> const &persons_indices,
+                                             GrB_Type type = GrB_BOOL) {
+        GrB_Index persons_nvals = persons_indices.size();
+        auto persons_diag_mx = GB(GrB_Matrix_new, type, input.persons.size(), input.persons.size());
+        ok(GrB_Matrix_build_BOOL(persons_diag_mx.get(),
+                                 persons_indices.data(), persons_indices.data(),
+                                 array_of_true(persons_nvals).get(), persons_nvals, GxB_PAIR_BOOL));
+        return persons_diag_mx;
+    }
+
     void tagCount_filtered_reachable_count_tags_strategy(GrB_Vector const local_persons,
                                                          SmallestElementsContainer<score_type, std::less<score_type>> &person_scores) {
         // maximum value: 10 -> UINT8
@@ -91,38 +77,28 @@ class Query3 : public Query<int, int, std::string> {
 
         GrB_Index common_interests_nvals;
         auto relevant_persons = GB(GrB_Vector_new, GrB_BOOL, input.persons.size());
+        auto new_persons = GB(GrB_Vector_new, GrB_BOOL, input.persons.size());
         GBxx_Object<GrB_Matrix> common_interests;
+        // rows of persons admitted in previous iterations are kept, only new sources are traversed
+        auto reachable_mx = GB(GrB_Matrix_new, GrB_BOOL, input.persons.size(), input.persons.size());
 
         for (int lower_tag_count = max_tag_count;;) {
             // add persons with less tags
             auto limit = GB(GxB_Scalar_new, GrB_UINT8);
             ok(GxB_Scalar_setElement_INT32(limit.get(), lower_tag_count));
-            ok(GxB_Vector_select(relevant_persons.get(), GrB_NULL, GxB_PAIR_BOOL, GxB_EQ_THUNK,
+            ok(GxB_Vector_select(new_persons.get(), GrB_NULL, GrB_NULL, GxB_EQ_THUNK,
                                  tag_count_per_person.get(),
                                  limit.get(), GrB_NULL));
-            GrB_Index relevant_persons_nvals;
-            ok(GrB_Vector_nvals(&relevant_persons_nvals, relevant_persons.get()));
-
-            std::vector<GrB_Index> relevant_persons_indices(relevant_persons_nvals);
-            {
-                GrB_Index nvals = relevant_persons_nvals;
-                ok(GrB_Vector_extractTuples_BOOL(relevant_persons_indices.data(), GrB_NULL, &nvals,
-                                                 relevant_persons.get()));
-                assert(relevant_persons_nvals == nvals);
-            }
-
+            ok(GrB_Vector_eWiseAdd_BinaryOp(relevant_persons.get(), GrB_NULL, GrB_NULL, GxB_PAIR_BOOL,
+                                            relevant_persons.get(), new_persons.get(), GrB_NULL));
             // build diagonal matrix of relevant persons
-            auto persons_diag_mx = GB(GrB_Matrix_new, GrB_BOOL, input.persons.size(), input.persons.size());
-            ok(GrB_Matrix_build_BOOL(persons_diag_mx.get(),
-                                     relevant_persons_indices.data(), relevant_persons_indices.data(),
-                                     array_of_true(relevant_persons_nvals).get(), relevant_persons_nvals,
-                                     GxB_PAIR_BOOL));
-
-            auto next_mx = GB(GrB_Matrix_dup, persons_diag_mx.get());
-            auto seen_mx = GB(GrB_Matrix_dup, next_mx.get());
+            auto persons_diag_mx = persons_diagonal(extract_indices(relevant_persons.get()));
 
-            // MSBFS from relevant persons
+            // MSBFS from new persons
+            auto seen_mx = persons_diagonal(extract_indices(new_persons.get()));
+            auto next_mx = GB(GrB_Matrix_dup, seen_mx.get());
             for (int i = 0; i < maximumHopCount; ++i) {
+                check_deadline();
                 ok(GrB_mxm(next_mx.get(), seen_mx.get(), GrB_NULL, GxB_ANY_PAIR_BOOL, next_mx.get(),
                            input.knows.matrix.get(), GrB_DESC_RSC));
 
@@ -135,15 +111,20 @@ class Query3 : public Query<int, int, std::string> {
                 ok(GrB_Matrix_eWiseAdd_BinaryOp(seen_mx.get(), GrB_NULL, GrB_NULL,
                                                 GxB_PAIR_BOOL, seen_mx.get(), next_mx.get(), GrB_NULL));
             }
+            // rows of sources are disjoint
+            ok(GrB_Matrix_eWiseAdd_BinaryOp(reachable_mx.get(), GrB_NULL, GrB_NULL,
+                                            GxB_PAIR_BOOL, reachable_mx.get(), seen_mx.get(), GrB_NULL));
 
             // strictly lower triangular matrix is enough for reachable persons
             // source persons were filtered at the beginning
             // drop friends in different place
-            ok(GxB_Matrix_select(seen_mx.get(), GrB_NULL, GrB_NULL, GxB_OFFDIAG, seen_mx.get(), GrB_NULL, GrB_NULL));
-            ok(GxB_Matrix_select(seen_mx.get(), GrB_NULL, GrB_NULL, GxB_TRIL, seen_mx.get(), GrB_NULL, GrB_NULL));
-            ok(GrB_mxm(seen_mx.get(), GrB_NULL, GrB_NULL, GxB_ANY_PAIR_BOOL, seen_mx.get(), persons_diag_mx.get(),
-                       GrB_NULL));
-            auto h_reachable_knows_tril = std::move(seen_mx);
+            auto h_reachable_knows_tril = GB(GrB_Matrix_new, GrB_BOOL, input.persons.size(), input.persons.size());
+            ok(GxB_Matrix_select(h_reachable_knows_tril.get(), GrB_NULL, GrB_NULL, GxB_OFFDIAG, reachable_mx.get(),
+                                 GrB_NULL, GrB_NULL));
+            ok(GxB_Matrix_select(h_reachable_knows_tril.get(), GrB_NULL, GrB_NULL, GxB_TRIL,
+                                 h_reachable_knows_tril.get(), GrB_NULL, GrB_NULL));
+            ok(GrB_mxm(h_reachable_knows_tril.get(), GrB_NULL, GrB_NULL, GxB_ANY_PAIR_BOOL,
+                       h_reachable_knows_tril.get(), persons_diag_mx.get(), GrB_NULL));
 
             // calculate common interests between persons in h hop distance
             common_interests = GB(GrB_Matrix_new, GrB_INT64, input.persons.size(), input.persons.size());
@@ -215,6 +196,118 @@ class Query3 : public Query<int, int, std::string> {
         ok(GrB_transpose(Seen, NULL, GxB_PAIR_UINT8, Next, GrB_DESC_T0));
     }
 
+    /// Collect person pairs meeting at high-degree columns of half_reachable.
+    /// Instead of enumerating the pairs of each column, rows of partners are united for every person with bitsets,
+    /// therefore each pair is produced once, even if the persons meet at several hubs.
+    /// \return the number of pairs added to thread_local_pairs
+    GrB_Index collect_hub_pairs(GrB_Matrix half_reachable, std::vector<GrB_Index> const &heavy_columns,
+                                std::vector<bool> const &is_new_person,
+                                std::vector<std::vector<uint64_t>> &thread_local_pairs) {
+        GrB_Index heavy_columns_num = heavy_columns.size();
+
+        // persons meeting at each hub with their values: 2 for the first half, 1 for the last "half" step
+        std::vector<std::vector<GrB_Index>> hub_persons(heavy_columns_num);
+        std::vector<std::vector<uint8_t>> hub_vals(heavy_columns_num);
+#pragma omp parallel num_threads(GlobalNThreads)
+        {
+            auto meeting_vertices = GB(GrB_Vector_new, GrB_UINT8, input.persons.size());
+#pragma omp for schedule(dynamic)
+            for (GrB_Index hub = 0; hub < heavy_columns_num; ++hub) {
+                ok(GrB_Col_extract(meeting_vertices.get(), GrB_NULL, GrB_NULL, half_reachable, GrB_ALL,
+                                   0, heavy_columns[hub], GrB_NULL));
+                GrB_Index nvals;
+                ok(GrB_Vector_nvals(&nvals, meeting_vertices.get()));
+                hub_persons[hub].resize(nvals);
+                hub_vals[hub].resize(nvals);
+                ok(GrB_Vector_extractTuples_UINT8(hub_persons[hub].data(), hub_vals[hub].data(), &nvals,
+                                                  meeting_vertices.get()));
+            }
+        }
+
+        // compact indices of persons meeting at any hub, which keep the order of person indices
+        std::vector<GrB_Index> members;
+        for (auto const &persons : hub_persons)
+            members.insert(members.end(), persons.begin(), persons.end());
+        std::sort(members.begin(), members.end());
+        members.erase(std::unique(members.begin(), members.end()), members.end());
+        GrB_Index members_num = members.size();
+        GrB_Index words_num = (members_num + 63) / 64;
+
+        // per hub: bitset of all meeting persons and of persons with value 2
+        // per member: hubs where the person meets others (CSR) with its value there
+        std::vector<uint64_t> hub_all_bits(heavy_columns_num * words_num), hub_two_bits(heavy_columns_num * words_num);
+        std::vector<GrB_Index> member_hub_offsets(members_num + 1);
+        for (GrB_Index hub = 0; hub < heavy_columns_num; ++hub) {
+            for (GrB_Index &person : hub_persons[hub]) {
+                // replace person index with compact index
+                person = std::lower_bound(members.begin(), members.end(), person) - members.begin();
+                ++member_hub_offsets[person + 1];
+            }
+        }
+        std::partial_sum(member_hub_offsets.begin(), member_hub_offsets.end(), member_hub_offsets.begin());
+        std::vector<std::pair<GrB_Index, uint8_t>> member_hubs(member_hub_offsets.back());
+        {
+            std::vector<GrB_Index> member_hub_positions(member_hub_offsets.begin(), member_hub_offsets.end() - 1);
+            for (GrB_Index hub = 0; hub < heavy_columns_num; ++hub) {
+                uint64_t *all_bits = hub_all_bits.data() + hub * words_num;
+                uint64_t *two_bits = hub_two_bits.data() + hub * words_num;
+                for (size_t i = 0; i < hub_persons[hub].size(); ++i) {
+                    GrB_Index member = hub_persons[hub][i];
+                    uint8_t val = hub_vals[hub][i];
+
+                    all_bits[member / 64] |= uint64_t{1} << (member % 64);
+                    if (val == 2)
+                        two_bits[member / 64] |= uint64_t{1} << (member % 64);
+                    member_hubs[member_hub_positions[member]++] = {hub, val};
+                }
+            }
+        }
+
+        // pairs of persons admitted earlier have already been evaluated
+        std::vector<uint64_t> new_member_bits(words_num);
+        for (GrB_Index member = 0; member < members_num; ++member)
+            if (is_new_person[members[member]])
+                new_member_bits[member / 64] |= uint64_t{1} << (member % 64);
+
+        GrB_Index hub_pairs = 0;
+#pragma omp parallel num_threads(thread_local_pairs.size()) reduction(+:hub_pairs)
+        {
+            std::vector<uint64_t> &pairs = thread_local_pairs[omp_get_thread_num()];
+            std::vector<uint64_t> partner_bits(words_num);
+
+#pragma omp for schedule(dynamic, 64)
+            for (GrB_Index member1 = 0; member1 < members_num; ++member1) {
+                // only partners with smaller indices are needed (lower triangle)
+                GrB_Index last_word = member1 / 64;
+                std::fill(partner_bits.begin(), partner_bits.begin() + last_word + 1, 0);
+
+                for (GrB_Index hub_iter = member_hub_offsets[member1];
+                     hub_iter < member_hub_offsets[member1 + 1]; ++hub_iter) {
+                    auto[hub, val1] = member_hubs[hub_iter];
+                    // 1 & 1 values means the persons meet after maximumHopCount + 1, which is invalid
+                    uint64_t const *bits = (val1 == 1 ? hub_two_bits : hub_all_bits).data() + hub * words_num;
+                    for (GrB_Index word = 0; word <= last_word; ++word)
+                        partner_bits[word] |= bits[word];
+                }
+                partner_bits[last_word] &= (uint64_t{1} << (member1 % 64)) - 1;
+                if (!is_new_person[members[member1]])
+                    for (GrB_Index word = 0; word <= last_word; ++word)
+                        partner_bits[word] &= new_member_bits[word];
+
+                GrB_Index p1 = members[member1];
+                for (GrB_Index word = 0; word <= last_word; ++word) {
+                    for (uint64_t bits = partner_bits[word]; bits != 0; bits &= bits - 1) {
+                        GrB_Index p2 = members[word * 64 + __builtin_ctzll(bits)];
+                        pairs.push_back(p1 << 32 | p2);
+                        ++hub_pairs;
+                    }
+                }
+            }
+        }
+
+        return hub_pairs;
+    }
+
     void tagCount_msbfs_strategy(GrB_Vector const local_persons,
                                  SmallestElementsContainer<score_type, std::less<score_type>> &person_scores) {
         // maximum value: 10 -> UINT8
@@ -233,45 +326,41 @@ class Query3 : public Query<int, int, std::string> {
         std::cerr << "max_tag_count: " << (unsigned) max_tag_count << std::endl;
 #endif
 
-        GBxx_Object<GrB_Matrix> last_common_interests_pattern = GB(GrB_Matrix_new, GrB_BOOL, input.persons.size(),
-                                                                   input.persons.size());
+        // person pairs evaluated in previous iterations
+        GBxx_Object<GrB_Matrix> evaluated_pairs_pattern = GB(GrB_Matrix_new, GrB_BOOL, input.persons.size(),
+                                                             input.persons.size());
+        // rows of persons admitted in previous iterations are kept, only new sources are traversed
+        GBxx_Object<GrB_Matrix> half_reachable = GB(GrB_Matrix_new, GrB_UINT8, input.persons.size(),
+                                                    input.persons.size());
 
         // persons with 10 tags, persons with 9..10 tags, ...
-        auto relevant_persons = GB(GrB_Vector_new, GrB_BOOL, input.persons.size());
+        auto new_persons = GB(GrB_Vector_new, GrB_BOOL, input.persons.size());
+        std::vector<bool> is_new_person(input.persons.size());
         for (int lower_tag_count = max_tag_count;;) {
 #ifndef NDEBUG
             std::cerr << "Loop:" << lower_tag_count << std::endl;
 #endif
+            TRACE_PHASES();
+            TRACE_PHASE("q3 MSBFS", "tag count: " + std::to_string(lower_tag_count));
             // add persons with less tags
             auto limit = GB(GxB_Scalar_new, GrB_UINT8);
             ok(GxB_Scalar_setElement_INT32(limit.get(), lower_tag_count));
-            ok(GxB_Vector_select(relevant_persons.get(), GrB_NULL, GxB_PAIR_BOOL, GxB_EQ_THUNK,
+            ok(GxB_Vector_select(new_persons.get(), GrB_NULL, GrB_NULL, GxB_EQ_THUNK,
                                  tag_count_per_person.get(),
                                  limit.get(), GrB_NULL));
-            GrB_Index relevant_persons_nvals;
-            ok(GrB_Vector_nvals(&relevant_persons_nvals, relevant_persons.get()));
-
-            // extract relevant person indices
-            std::vector<GrB_Index> relevant_persons_indices(relevant_persons_nvals);
-            {
-                GrB_Index nvals = relevant_persons_nvals;
-                ok(GrB_Vector_extractTuples_BOOL(relevant_persons_indices.data(), GrB_NULL, &nvals,
-                                                 relevant_persons.get()));
-                assert(relevant_persons_nvals == nvals);
-            }
 
-            // build diagonal matrix of relevant persons
-            auto persons_diag_mx = GB(GrB_Matrix_new, GrB_UINT8, input.persons.size(), input.persons.size());
-            ok(GrB_Matrix_build_UINT8(persons_diag_mx.get(),
-                                      relevant_persons_indices.data(), relevant_persons_indices.data(),
-                                      (uint8_t *) array_of_true(relevant_persons_nvals).get(), relevant_persons_nvals,
-                                      GxB_PAIR_BOOL));
+            // extract new person indices
+            std::vector<GrB_Index> new_persons_indices = extract_indices(new_persons.get());
+            is_new_person.assign(input.persons.size(), false);
+            for (GrB_Index person_index : new_persons_indices)
+                is_new_person[person_index] = true;
 
-            auto next_mx = GB(GrB_Matrix_dup, persons_diag_mx.get());
+            auto next_mx = persons_diagonal(new_persons_indices, GrB_UINT8);
             auto seen_mx = GB(GrB_Matrix_dup, next_mx.get());
 
-            // MSBFS from relevant persons
+            // MSBFS from new persons
             for (int i = 0; i < maximumHopCount / 2; ++i) {
+                check_deadline();
                 push_next(next_mx.get(), seen_mx.get(), input.knows.matrix.get());
             }
             // persons reached in the first (maximumHopCount / 2) steps are marked with 2
@@ -288,12 +377,22 @@ class Query3 : public Query<int, int, std::string> {
 
             // TODO: offdiag? tril?
 //            ok(GxB_Matrix_select(seen_mx.get(), GrB_NULL, GrB_NULL, GxB_OFFDIAG, seen_mx.get(), GrB_NULL, GrB_NULL));
-            auto half_reachable = std::move(seen_mx);
+
+            TRACE_PHASE("q3 meeting columns");
+            // new pairs contain a new person, so they can only meet where new persons arrived
+            auto new_columns = GB(GrB_Vector_new, GrB_BOOL, input.persons.size());
+            ok(GrB_Matrix_reduce_Monoid(new_columns.get(), GrB_NULL, GrB_NULL, GrB_LOR_MONOID_BOOL,
+                                        seen_mx.get(), GrB_DESC_T0));
+
+            // rows of sources are disjoint
+            ok(GrB_Matrix_eWiseAdd_BinaryOp(half_reachable.get(), GrB_NULL, GrB_NULL, GrB_FIRST_UINT8,
+                                            half_reachable.get(), seen_mx.get(), GrB_NULL));
+            seen_mx.reset();
 
             // find vertices where relevant persons meet: reduce to row vector
             auto columns_where_vertices_meet = GB(GrB_Vector_new, GrB_UINT64, input.persons.size());
-            ok(GrB_Matrix_reduce_Monoid(columns_where_vertices_meet.get(), GrB_NULL, GrB_NULL,
-                                        GrB_PLUS_MONOID_UINT64, half_reachable.get(), GrB_DESC_T0));
+            ok(GrB_Matrix_reduce_Monoid(columns_where_vertices_meet.get(), new_columns.get(), GrB_NULL,
+                                        GrB_PLUS_MONOID_UINT64, half_reachable.get(), GrB_DESC_ST0));
 #ifndef NDEBUG
             {
                 GrB_Index nvals;
@@ -321,39 +420,68 @@ class Query3 : public Query<int, int, std::string> {
             GrB_Index columns_where_vertices_meet_nvals;
             ok(GrB_Vector_nvals(&columns_where_vertices_meet_nvals, columns_where_vertices_meet.get()));
             std::vector<GrB_Index> columns_where_vertices_meet_indices(columns_where_vertices_meet_nvals);
+            std::vector<uint64_t> columns_where_vertices_meet_vals(columns_where_vertices_meet_nvals);
             {
                 GrB_Index nvals = columns_where_vertices_meet_nvals;
-                ok(GrB_Vector_extractTuples_UINT64(columns_where_vertices_meet_indices.data(), nullptr, &nvals,
+                ok(GrB_Vector_extractTuples_UINT64(columns_where_vertices_meet_indices.data(),
+                                                   columns_where_vertices_meet_vals.data(), &nvals,
                                                    columns_where_vertices_meet.get()));
                 assert(columns_where_vertices_meet_nvals == nvals);
             }
 
+            // hubs: the number of persons meeting at a column is at least half of its value
+            std::vector<GrB_Index> light_columns, heavy_columns;
+            for (GrB_Index i = 0; i < columns_where_vertices_meet_nvals; ++i) {
+                if (benchmarkParameters.Q3HubThreshold != 0
+                    && columns_where_vertices_meet_vals[i] >= 2 * benchmarkParameters.Q3HubThreshold)
+                    heavy_columns.push_back(columns_where_vertices_meet_indices[i]);
+                else
+                    light_columns.push_back(columns_where_vertices_meet_indices[i]);
+            }
+
 #ifndef NDEBUG
             std::cerr << "columns_where_vertices_meet_nvals after select:" << columns_where_vertices_meet_nvals
                       << std::endl;
 #endif
 
-            // calculate common interests between persons in h hop distance
-            GBxx_Object<GrB_Matrix> common_interests_global = GB(GrB_Matrix_new, GrB_UINT64, input.persons.size(),
-                                                                 input.persons.size());
-
-#pragma omp parallel num_threads(GlobalNThreads)
+            TRACE_PHASE("q3 pairs");
+            // collect person pairs meeting at these vertices into thread-local, append-only buffers
+            // pairs are packed as (p1 << 32) | p2, sorting them orders by row then column
+            assert(input.persons.size() <= (uint64_t{1} << 32));
+            // each entry is visited once when pairing persons
+            GrB_Index half_reachable_nvals;
+            ok(GrB_Matrix_nvals(&half_reachable_nvals, half_reachable.get()));
+            int nthreads = phase_threads(benchmarkParameters, "Q3 meeting pairs", half_reachable_nvals);
+            std::vector<std::vector<uint64_t>> thread_local_pairs(nthreads);
+            std::vector<size_t> thread_local_offsets(nthreads + 1);
+            std::vector<GrB_Index> pair_rows, pair_cols;
+
+            GrB_Index heavy_pairs = 0, light_pairs = 0;
+            if (!heavy_columns.empty())
+                heavy_pairs = collect_hub_pairs(half_reachable.get(), heavy_columns, is_new_person,
+                                                thread_local_pairs);
+
+#pragma omp parallel num_threads(nthreads) reduction(+:light_pairs)
             {
-                // thread-local
-                GBxx_Object<GrB_Matrix> common_interests = GB(GrB_Matrix_new, GrB_UINT64, input.persons.size(),
-                                                              input.persons.size());
-#pragma omp for schedule(static)
-                for (GrB_Index i = 0; i < columns_where_vertices_meet_nvals; ++i) {
-                    GrB_Index meet_column = columns_where_vertices_meet_indices[i];
+                std::vector<uint64_t> &pairs = thread_local_pairs[omp_get_thread_num()];
+                auto meeting_vertices = GB(GrB_Vector_new, GrB_UINT8, input.persons.size());
+                std::vector<GrB_Index> meeting_vertices_indices;
+                std::vector<uint8_t> meeting_vertices_vals;
+
+                // the buffer might already hold pairs of hubs
+                size_t hub_pairs_nvals = pairs.size();
+
+#pragma omp for schedule(dynamic)
+                for (GrB_Index i = 0; i < light_columns.size(); ++i) {
+                    GrB_Index meet_column = light_columns[i];
 
                     // get persons who meet at vertex meet_column
-                    auto meeting_vertices = GB(GrB_Vector_new, GrB_UINT8, input.persons.size());
                     ok(GrB_Col_extract(meeting_vertices.get(), GrB_NULL, GrB_NULL, half_reachable.get(), GrB_ALL,
                                        0, meet_column, GrB_NULL));
                     GrB_Index meeting_vertices_nvals;
                     ok(GrB_Vector_nvals(&meeting_vertices_nvals, meeting_vertices.get()));
-                    std::vector<GrB_Index> meeting_vertices_indices(meeting_vertices_nvals);
-                    std::vector<uint8_t> meeting_vertices_vals(meeting_vertices_nvals);
+                    meeting_vertices_indices.resize(meeting_vertices_nvals);
+                    meeting_vertices_vals.resize(meeting_vertices_nvals);
                     {
                         GrB_Index nvals = meeting_vertices_nvals;
                         ok(GrB_Vector_extractTuples_UINT8(meeting_vertices_indices.data(),
@@ -373,26 +501,57 @@ class Query3 : public Query<int, int, std::string> {
 
                             GrB_Index p1 = meeting_vertices_indices[p1_iter];
                             GrB_Index p2 = meeting_vertices_indices[p2_iter];
-                            ok(GrB_Matrix_setElement_UINT64(common_interests.get(), 0, p1, p2));
+                            // pairs of persons admitted earlier have already been evaluated
+                            if (!is_new_person[p1] && !is_new_person[p2])
+                                continue;
+
+                            pairs.push_back(p1 << 32 | p2);
                         }
                     }
                 }
 
-#pragma omp critical(Q3_merge_thread_local_matrices)
+                light_pairs += pairs.size() - hub_pairs_nvals;
+
+                // deduplicate thread-local pairs
+                std::sort(pairs.begin(), pairs.end());
+                pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+
+#pragma omp barrier
+#pragma omp single
                 {
-                    ok(GrB_transpose(common_interests_global.get(), last_common_interests_pattern.get(),
-                                     GxB_PAIR_UINT64,
-                                     common_interests.get(),
-                                     GrB_DESC_SCT0));
-                    auto ptr = common_interests_global.release();
-                    ok(GrB_Matrix_wait(&ptr));
-                    common_interests_global.reset(ptr);
+                    for (int thread = 0; thread < nthreads; ++thread)
+                        thread_local_offsets[thread + 1] = thread_local_offsets[thread] + thread_local_pairs[thread].size();
+                    pair_rows.resize(thread_local_offsets[nthreads]);
+                    pair_cols.resize(thread_local_offsets[nthreads]);
                 }
+
+                // unpack own buffer into its slice of the global tuple arrays
+                size_t offset = thread_local_offsets[omp_get_thread_num()];
+                for (size_t i = 0; i < pairs.size(); ++i) {
+                    pair_rows[offset + i] = pairs[i] >> 32;
+                    pair_cols[offset + i] = pairs[i] & UINT32_MAX;
+                }
+                std::vector<uint64_t>().swap(pairs);
             }
 
-            // store current pattern to evaluate only once
-            ok(GrB_transpose(last_common_interests_pattern.get(), GrB_NULL, GxB_PAIR_BOOL,
-                             common_interests_global.get(), GrB_DESC_T0));
+            TRACE_PHASE("q3 mxm scoring");
+            // calculate common interests between persons in h hop distance
+            // the pattern is built at once, pairs found by more threads are merged by the parallel sort of build
+            GrB_Index pairs_nvals = pair_rows.size();
+            GBxx_Object<GrB_Matrix> common_interests_global = GB(GrB_Matrix_new, GrB_UINT64, input.persons.size(),
+                                                                 input.persons.size());
+            ok(GrB_Matrix_build_UINT64(common_interests_global.get(), pair_rows.data(), pair_cols.data(),
+                                       std::vector<uint64_t>(pairs_nvals).data(), pairs_nvals, GxB_PAIR_UINT64));
+            if (benchmarkParameters.PrintStats)
+                std::cerr << "Q3 pairs: light columns: " << light_columns.size()
+                          << ", heavy columns: " << heavy_columns.size()
+                          << ", light pairs: " << light_pairs
+                          << ", heavy pairs: " << heavy_pairs
+                          << ", unique pairs: " << pairs_nvals << std::endl;
+
+            // every pair contains a new person, therefore it is evaluated only once
+            ok(GrB_Matrix_eWiseAdd_BinaryOp(evaluated_pairs_pattern.get(), GrB_NULL, GrB_NULL, GxB_PAIR_BOOL,
+                                            evaluated_pairs_pattern.get(), common_interests_global.get(), GrB_NULL));
             // keep offdiag tril
             ok(GxB_Matrix_select(common_interests_global.get(), GrB_NULL, GrB_NULL,
                                  GxB_OFFDIAG, common_interests_global.get(), GrB_NULL, GrB_NULL));
@@ -415,17 +574,18 @@ class Query3 : public Query<int, int, std::string> {
             if (lower_tag_count == 0 && person_scores.size() < topKLimit) {
                 might_contain_duplicates = true;
                 // there are not enough non-zero scores
-                // add reachable persons with zero common tags
+                // add reachable persons with zero common tags, including pairs of previous iterations
                 // assign 0 to every reachable person pair, but select non-zero score (first operand) if present
-                // common_interests <h_reachable_knows_tril> 1ST= 0
+                // common_interests <evaluated_pairs_pattern> 1ST= 0
                 ok(GrB_Matrix_assign_INT64(common_interests_global.get(),
-                                           last_common_interests_pattern.get(), GrB_FIRST_INT64,
+                                           evaluated_pairs_pattern.get(), GrB_FIRST_INT64,
                                            0, GrB_ALL, 0, GrB_ALL, 0, GrB_DESC_S));
 
                 // recount nvals
                 ok(GrB_Matrix_nvals(&common_interests_nvals, common_interests_global.get()));
             }
 
+            TRACE_PHASE("q3 top-k");
             // extract result from matrix
             std::vector<GrB_Index> common_interests_rows(common_interests_nvals),
                     common_interests_cols(common_interests_nvals);
@@ -473,70 +633,11 @@ class Query3 : public Query<int, int, std::string> {
         }
     }
 
-    void reachable_count_tags_strategy(GrB_Vector const local_persons,
-                                       GrB_Index const local_persons_nvals,
-                                       SmallestElementsContainer<score_type, std::less<score_type>> &person_scores) {
-        std::vector<GrB_Index> local_persons_indices(local_persons_nvals);
-        {
-            GrB_Index nvals = local_persons_nvals;
-            ok(GrB_Vector_extractTuples_BOOL(local_persons_indices.data(), GrB_NULL, &nvals,
-                                             local_persons));
-            assert(local_persons_nvals == nvals);
-        }
-
-        // build diagonal matrix of local persons
-        auto persons_diag_mx = GB(GrB_Matrix_new, GrB_BOOL, input.persons.size(), input.persons.size());
-        ok(GrB_Matrix_build_BOOL(persons_diag_mx.get(),
-                                 local_persons_indices.data(), local_persons_indices.data(),
-                                 array_of_true(local_persons_nvals).get(), local_persons_nvals, GxB_PAIR_BOOL));
-
-        auto next_mx = GB(GrB_Matrix_dup, persons_diag_mx.get());
-        auto seen_mx = GB(GrB_Matrix_dup, next_mx.get());
-
-        // MSBFS from relevant persons
-        for (int i = 0; i < maximumHopCount; ++i) {
-            ok(GrB_mxm(next_mx.get(), seen_mx.get(), GrB_NULL, GxB_ANY_PAIR_BOOL, next_mx.get(),
-                       input.knows.matrix.get(), GrB_DESC_RSC));
-
-            GrB_Index next_mx_nvals;
-            ok(GrB_Matrix_nvals(&next_mx_nvals, next_mx.get()));
-            // if emptied the component
-            if (next_mx_nvals == 0)
-                break;
-
-            ok(GrB_Matrix_eWiseAdd_BinaryOp(seen_mx.get(), GrB_NULL, GrB_NULL,
-                                            GxB_PAIR_BOOL, seen_mx.get(), next_mx.get(), GrB_NULL));
-        }
-
-        // strictly lower triangular matrix is enough for reachable persons
-        // source persons were filtered at the beginning
-        // drop friends in different place
-        ok(GxB_Matrix_select(seen_mx.get(), GrB_NULL, GrB_NULL, GxB_OFFDIAG, seen_mx.get(), GrB_NULL, GrB_NULL));
-        ok(GxB_Matrix_select(seen_mx.get(), GrB_NULL, GrB_NULL, GxB_TRIL, seen_mx.get(), GrB_NULL, GrB_NULL));
-        ok(GrB_mxm(seen_mx.get(), GrB_NULL, GrB_NULL, GxB_ANY_PAIR_BOOL, seen_mx.get(), persons_diag_mx.get(),
-                   GrB_NULL));
-        auto h_reachable_knows_tril = std::move(seen_mx);
-
-        // calculate common interests between persons in h hop distance
-        auto common_interests = GB(GrB_Matrix_new, GrB_INT64, input.persons.size(), input.persons.size());
-        ok(GrB_mxm(common_interests.get(), h_reachable_knows_tril.get(), GrB_NULL, GxB_PLUS_TIMES_INT64,
-                   hasInterest.get(), input.hasInterestTran.matrix.get(), GrB_DESC_S));
-
-        // count tag scores per person pairs
+    void add_scores(GrB_Matrix common_interests,
+                    SmallestElementsContainer<score_type, std::less<score_type>> &person_scores) {
+        TRACE_SCOPE("q3 top-k");
         GrB_Index common_interests_nvals;
-        ok(GrB_Matrix_nvals(&common_interests_nvals, common_interests.get()));
-
-        if (common_interests_nvals < topKLimit) {
-            // there are not enough non-zero scores
-            // add reachable persons with zero common tags
-            // assign 0 to every reachable person pair, but select non-zero score (first operand) if present
-            // common_interests <h_reachable_knows_tril> 1ST= 0
-            ok(GrB_Matrix_assign_INT64(common_interests.get(), h_reachable_knows_tril.get(), GrB_FIRST_INT64,
-                                       0, GrB_ALL, 0, GrB_ALL, 0, GrB_DESC_S));
-
-            // recount nvals
-            ok(GrB_Matrix_nvals(&common_interests_nvals, common_interests.get()));
-        }
+        ok(GrB_Matrix_nvals(&common_interests_nvals, common_interests));
 
         // extract result from matrix
         std::vector<GrB_Index> common_interests_rows(common_interests_nvals),
@@ -545,7 +646,7 @@ class Query3 : public Query<int, int, std::string> {
         {
             GrB_Index nvals = common_interests_nvals;
             ok(GrB_Matrix_extractTuples_INT64(common_interests_rows.data(), common_interests_cols.data(),
-                                              common_interests_vals.data(), &nvals, common_interests.get()));
+                                              common_interests_vals.data(), &nvals, common_interests));
             assert(common_interests_nvals == nvals);
         }
 
@@ -566,11 +667,213 @@ class Query3 : public Query<int, int, std::string> {
         }
     }
 
+    /// Score pairs of persons in h hop distance by their common interests, including zero scores if needed.
+    void score_reachable_pairs(GrB_Matrix h_reachable_knows_tril,
+                               SmallestElementsContainer<score_type, std::less<score_type>> &person_scores) {
+        TRACE_PHASES();
+        TRACE_PHASE("q3 mxm scoring");
+        // calculate common interests between persons in h hop distance
+        auto common_interests = GB(GrB_Matrix_new, GrB_INT64, input.persons.size(), input.persons.size());
+        ok(GrB_mxm(common_interests.get(), h_reachable_knows_tril, GrB_NULL, GxB_PLUS_TIMES_INT64,
+                   hasInterest.get(), input.hasInterestTran.matrix.get(), GrB_DESC_S));
+        add_scores(common_interests.get(), person_scores);
+
+        // the k-th best score is not positive (or there are less than k scores):
+        // reachable persons with zero common tags might be in the top list
+        if (person_scores.size() < topKLimit || std::get<0>(person_scores.max()) == 0) {
+            // zero_interests <h_reachable_knows_tril> = 0
+            TRACE_PHASE("q3 zero scores");
+            auto zero_interests = GB(GrB_Matrix_new, GrB_INT64, input.persons.size(), input.persons.size());
+            ok(GrB_Matrix_assign_INT64(zero_interests.get(), h_reachable_knows_tril, GrB_NULL,
+                                       0, GrB_ALL, 0, GrB_ALL, 0, GrB_DESC_S));
+            // drop pairs with non-zero scores: zero_interests <!common_interests, replace> = zero_interests
+            ok(GrB_Matrix_apply(zero_interests.get(), common_interests.get(), GrB_NULL, GrB_IDENTITY_INT64,
+                                zero_interests.get(), GrB_DESC_RSC));
+            add_scores(zero_interests.get(), person_scores);
+        }
+    }
+
+    /// Estimated bytes of an entry in the MSBFS matrices: seen, next and the workspace of mxm
+    static constexpr GrB_Index MsbfsBytesPerEntry = 32;
+
+    void reachable_count_tags_strategy(GrB_Vector const local_persons,
+                                       GrB_Index const local_persons_nvals,
+                                       SmallestElementsContainer<score_type, std::less<score_type>> &person_scores) {
+        std::vector<GrB_Index> local_persons_indices = extract_indices(local_persons);
+        assert(local_persons_nvals == local_persons_indices.size());
+
+        // build diagonal matrix of local persons
+        auto persons_diag_mx = persons_diagonal(local_persons_indices);
+
+        // without memory budget all local persons are traversed at once,
+        // otherwise start by assuming that sources reach every person
+        uint64_t const memory_budget = benchmarkParameters.Q3MemoryBudget;
+        GrB_Index batch_size = local_persons_nvals;
+        if (memory_budget != 0)
+            batch_size = std::clamp<GrB_Index>(memory_budget / (input.persons.size() * MsbfsBytesPerEntry),
+                                               1, local_persons_nvals);
+        GrB_Index batch_count = 0, peak_nvals = 0;
+
+        // each pair is found from the source with higher index (lower triangle), so batches produce disjoint pairs
+        for (GrB_Index batch_begin = 0; batch_begin < local_persons_nvals; batch_begin += batch_size) {
+            GrB_Index batch_end = std::min(batch_begin + batch_size, local_persons_nvals);
+            std::vector<GrB_Index> batch_persons_indices(local_persons_indices.begin() + batch_begin,
+                                                         local_persons_indices.begin() + batch_end);
+            ++batch_count;
+
+            TRACE_PHASES();
+            TRACE_PHASE("q3 MSBFS", "batch: " + std::to_string(batch_count));
+            auto next_mx = persons_diagonal(batch_persons_indices);
+            auto seen_mx = GB(GrB_Matrix_dup, next_mx.get());
+            GrB_Index batch_peak_nvals = 0;
+
+            // MSBFS from source persons of the batch
+            for (int i = 0; i < maximumHopCount; ++i) {
+                check_deadline();
+                ok(GrB_mxm(next_mx.get(), seen_mx.get(), GrB_NULL, GxB_ANY_PAIR_BOOL, next_mx.get(),
+                           input.knows.matrix.get(), GrB_DESC_RSC));
+
+                GrB_Index next_mx_nvals;
+                ok(GrB_Matrix_nvals(&next_mx_nvals, next_mx.get()));
+                // if emptied the component
+                if (next_mx_nvals == 0)
+                    break;
+
+                ok(GrB_Matrix_eWiseAdd_BinaryOp(seen_mx.get(), GrB_NULL, GrB_NULL,
+                                                GxB_PAIR_BOOL, seen_mx.get(), next_mx.get(), GrB_NULL));
+
+                GrB_Index seen_mx_nvals;
+                ok(GrB_Matrix_nvals(&seen_mx_nvals, seen_mx.get()));
+                batch_peak_nvals = std::max(batch_peak_nvals, seen_mx_nvals + next_mx_nvals);
+            }
+            next_mx.reset();
+            peak_nvals = std::max(peak_nvals, batch_peak_nvals);
+
+            TRACE_PHASE("q3 pairs");
+            // strictly lower triangular matrix is enough for reachable persons
+            // source persons were filtered at the beginning
+            // drop friends in different place
+            ok(GxB_Matrix_select(seen_mx.get(), GrB_NULL, GrB_NULL, GxB_OFFDIAG, seen_mx.get(), GrB_NULL, GrB_NULL));
+            ok(GxB_Matrix_select(seen_mx.get(), GrB_NULL, GrB_NULL, GxB_TRIL, seen_mx.get(), GrB_NULL, GrB_NULL));
+            ok(GrB_mxm(seen_mx.get(), GrB_NULL, GrB_NULL, GxB_ANY_PAIR_BOOL, seen_mx.get(), persons_diag_mx.get(),
+                       GrB_NULL));
+            auto h_reachable_knows_tril = std::move(seen_mx);
+
+            TRACE_PHASE("q3 scoring");
+            score_reachable_pairs(h_reachable_knows_tril.get(), person_scores);
+
+            // size the next batch based on the footprint observed per source person
+            if (memory_budget != 0 && batch_peak_nvals != 0) {
+                GrB_Index bytes_per_source = std::max<GrB_Index>(
+                        batch_peak_nvals * MsbfsBytesPerEntry / (batch_end - batch_begin), 1);
+                batch_size = std::clamp<GrB_Index>(memory_budget / bytes_per_source, 1, 4 * batch_size);
+            }
+        }
+
+        if (benchmarkParameters.PrintStats)
+            std::cerr << "Q3 MSBFS batches: " << batch_count
+                      << ", peak estimated bytes: " << peak_nvals * MsbfsBytesPerEntry << std::endl;
+    }
+
+    /// MSBFS from all local persons recording the distance where pairs of local persons were first reached.
+    std::shared_ptr<PlaceReachability const> compute_place_reachability(
+            std::vector<GrB_Index> const &local_persons_indices, int hop_count) {
+        TRACE_PHASES();
+        TRACE_PHASE("q3 MSBFS", "hop count: " + std::to_string(hop_count));
+        auto persons_diag_mx = persons_diagonal(local_persons_indices);
+        auto next_mx = GB(GrB_Matrix_dup, persons_diag_mx.get());
+        // sources are at distance 0, they are dropped by OFFDIAG
+        auto distances = GB(GrB_Matrix_new, GrB_UINT8, input.persons.size(), input.persons.size());
+        ok(GrB_Matrix_assign_UINT8(distances.get(), next_mx.get(), GrB_NULL, 0, GrB_ALL, 0, GrB_ALL, 0,
+                                   GrB_DESC_S));
+
+        int reached_hop_count = hop_count;
+        for (int level = 1; level <= hop_count; ++level) {
+            check_deadline();
+            ok(GrB_mxm(next_mx.get(), distances.get(), GrB_NULL, GxB_ANY_PAIR_BOOL, next_mx.get(),
+                       input.knows.matrix.get(), GrB_DESC_RSC));
+
+            GrB_Index next_mx_nvals;
+            ok(GrB_Matrix_nvals(&next_mx_nvals, next_mx.get()));
+            // if emptied the component, the result is valid for any hop count
+            if (next_mx_nvals == 0) {
+                reached_hop_count = std::numeric_limits<int>::max();
+                break;
+            }
+
+            // saturate distances, hop counts beyond UINT8_MAX select every pair anyway
+            ok(GrB_Matrix_assign_UINT8(distances.get(), next_mx.get(), GrB_NULL,
+                                       std::min(level, int{UINT8_MAX}), GrB_ALL, 0, GrB_ALL, 0, GrB_DESC_S));
+        }
+        next_mx.reset();
+
+        TRACE_PHASE("q3 pairs");
+        // strictly lower triangular matrix of local persons, keeping distances
+        ok(GxB_Matrix_select(distances.get(), GrB_NULL, GrB_NULL, GxB_OFFDIAG, distances.get(), GrB_NULL,
+                             GrB_NULL));
+        ok(GxB_Matrix_select(distances.get(), GrB_NULL, GrB_NULL, GxB_TRIL, distances.get(), GrB_NULL, GrB_NULL));
+        ok(GrB_mxm(distances.get(), GrB_NULL, GrB_NULL, GxB_MIN_FIRST_UINT8, distances.get(),
+                   persons_diag_mx.get(), GrB_NULL));
+        // finish pending work, the cached matrix is read concurrently
+        GrB_Matrix distances_ptr = distances.get();
+        ok(GrB_Matrix_wait(&distances_ptr));
+
+        GrB_Index distances_nvals;
+        ok(GrB_Matrix_nvals(&distances_nvals, distances.get()));
+
+        return std::make_shared<PlaceReachability const>(
+                PlaceReachability{reached_hop_count, std::move(distances), distances_nvals});
+    }
+
+    /// Reachability of places is cached with distances up to the largest hop count seen,
+    /// so queries of the same place with at most that hop count only filter and score the pairs.
+    void cached_reachability_strategy(GrB_Vector const local_persons,
+                                      SmallestElementsContainer<score_type, std::less<score_type>> &person_scores) {
+        QueryCaches &caches = input.caches;
+        GrB_Index place_index = input.places.findIndexByName(placeName);
+
+        auto reachability = caches.placeReachability.find(place_index, [this](auto const &value) {
+            return value->hopCount >= maximumHopCount;
+        });
+        if (!reachability) {
+            int hop_count = caches.placeReachabilityMaxHopCount.load();
+            while (hop_count < maximumHopCount &&
+                   !caches.placeReachabilityMaxHopCount.compare_exchange_weak(hop_count, maximumHopCount));
+            hop_count = std::max(hop_count, maximumHopCount);
+
+            reachability = compute_place_reachability(extract_indices(local_persons), hop_count);
+            caches.placeReachability.insert(place_index, *reachability);
+        }
+
+        GrB_Matrix distances = (*reachability)->distances.get();
+        if (maximumHopCount >= (*reachability)->hopCount) {
+            score_reachable_pairs(distances, person_scores);
+        } else {
+            // pairs in at most h hop distance
+            auto h_reachable_knows_tril = GB(GrB_Matrix_new, GrB_UINT8, input.persons.size(),
+                                             input.persons.size());
+            auto limit = GB(GxB_Scalar_new, GrB_UINT8);
+            ok(GxB_Scalar_setElement_INT32(limit.get(), std::min(maximumHopCount, int{UINT8_MAX})));
+            ok(GxB_Matrix_select(h_reachable_knows_tril.get(), GrB_NULL, GrB_NULL, GxB_LE_THUNK, distances,
+                                 limit.get(), GrB_NULL));
+            score_reachable_pairs(h_reachable_knows_tril.get(), person_scores);
+        }
+
+        if (benchmarkParameters.PrintStats)
+            std::cerr << "Q3 reachability cache: hits: " << caches.placeReachability.hits()
+                      << ", misses: " << caches.placeReachability.misses()
+                      << ", evictions: " << caches.placeReachability.evictions()
+                      << ", bytes: " << caches.placeReachability.size() << std::endl;
+    }
+
     std::tuple<std::string, std::string> initial_calculation() override {
+        TRACE_PHASES();
+        TRACE_PHASE("q3 interests");
         hasInterest = GB(GrB_Matrix_new, GrB_BOOL, input.hasInterestTran.trg->size(),
                          input.hasInterestTran.src->size());
         ok(GrB_transpose(hasInterest.get(), GrB_NULL, GrB_NULL, input.hasInterestTran.matrix.get(), GrB_NULL));
 
+        TRACE_PHASE("q3 relevant persons");
         auto local_persons = getRelevantPersons();
 
         // extract person indices
@@ -581,10 +884,17 @@ class Query3 : public Query<int, int, std::string> {
 
         auto person_scores = makeSmallestElementsContainer<score_type>(topKLimit);
 
-//        reachable_count_tags_strategy(local_persons.get(), relevant_persons_nvals, person_scores);
+        TRACE_PHASE("q3 traversal");
+        // traverse from all local persons at once, unless reachability is cached or should fit into a memory budget
+        if (input.caches.placeReachability.enabled())
+            cached_reachability_strategy(local_persons.get(), person_scores);
+        else if (benchmarkParameters.Q3MemoryBudget != 0)
+            reachable_count_tags_strategy(local_persons.get(), relevant_persons_nvals, person_scores);
+        else
 //        tagCount_filtered_reachable_count_tags_strategy(local_persons.get(), person_scores);
-        tagCount_msbfs_strategy(local_persons.get(), person_scores);
+            tagCount_msbfs_strategy(local_persons.get(), person_scores);
 
+        TRACE_PHASE("q3 result");
         std::string result, comment;
         bool firstIter = true;
         for (auto[neg_score, p1_id, p2_id]: person_scores.removeElements()) {
@@ -607,6 +917,10 @@ class Query3 : public Query<int, int, std::string> {
         return {result, comment};
     }
 
+    std::optional<uint64_t> resultLimit() const override {
+        return topKLimit;
+    }
+
 public:
     int getQueryId() const override {
         return 3;
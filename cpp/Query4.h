@@ -1,7 +1,7 @@
 #pragma once
 
-#include "ccv.h"
-#include "ccv-bool.h"
+#include "ccv-kernels.h"
+#include "SmallestElementsContainer.h"
 #include "Query.h"
 #include "utils.h"
 
@@ -16,45 +16,106 @@
 #include <cstdio>
 
 class Query4 : public Query<int, std::string> {
+public:
+    using person_score_type = std::tuple<double, uint64_t>;
+
+private:
     int topKLimit;
     std::string tagName;
 
+    /// Members of the tag's forums ordered by closeness centrality (DESC) and person ID (ASC), the first k of them.
+    std::vector<person_score_type> compute_ranking(GrB_Index tag_index, int k) {
+        std::vector<GrB_Index> relevant_person_indices;
+        CsrGraph member_friends = memberFriends(input, tag_index, relevant_person_indices);
+        return rankMembers(benchmarkParameters, input, member_friends, relevant_person_indices, k);
+    }
+
+    /// Rankings are cached with the largest k seen so far, a repeated tag with smaller k takes a prefix.
+    std::vector<person_score_type> cached_ranking(GrB_Index tag_index) {
+        QueryCaches &caches = input.caches;
+
+        auto ranking = findCachedRanking(caches, tag_index, topKLimit);
+        if (!ranking) {
+            int k = cachedRankingK(caches, topKLimit);
+            ranking = std::make_shared<TagRanking const>(TagRanking{uint64_t(k), compute_ranking(tag_index, k)});
+            caches.tagRanking.insert(tag_index, ranking);
+        }
+
+        if (benchmarkParameters.PrintStats)
+            std::cerr << "Q4 ranking cache: hits: " << caches.tagRanking.hits()
+                      << ", misses: " << caches.tagRanking.misses()
+                      << ", evictions: " << caches.tagRanking.evictions()
+                      << ", bytes: " << caches.tagRanking.size() << std::endl;
+
+        auto const &cached = ranking->ranking;
+        return {cached.begin(), cached.begin() + std::min<size_t>(cached.size(), topKLimit)};
+    }
+
+    std::optional<uint64_t> resultLimit() const override {
+        return topKLimit;
+    }
+
+    /// Approximate rankings are cached apart from exact ones, the exact kernels give the same ranking.
+    std::string resultOptions() const override {
+        if (benchmarkParameters.Q4ApproximateError <= 0)
+            return "";
+        std::ostringstream options;
+        options << "approximate:" << benchmarkParameters.Q4ApproximateError << ':'
+                << benchmarkParameters.Q4ApproximateConfidence;
+        return options.str();
+    }
+
     std::tuple<std::string, std::string> initial_calculation() override {
         // find tag
         GrB_Index tag_index = input.tags.findIndexByName(tagName);
 
-        // hasTag
-        GBxx_Object<GrB_Vector> relevant_forums = GB(GrB_Vector_new, GrB_BOOL, input.forums.size());
-        ok(GrB_Col_extract(relevant_forums.get(), GrB_NULL, GrB_NULL,
-                           input.hasTag.matrix.get(), GrB_ALL, 0,
-                           tag_index, GrB_NULL));
-        // hasMember
-        GBxx_Object<GrB_Vector> relevant_persons = GB(GrB_Vector_new, GrB_BOOL, input.persons.size());
-        ok(GrB_vxm(relevant_persons.get(), GrB_NULL, GrB_NULL,
-                   GxB_LOR_LAND_BOOL, relevant_forums.get(), input.hasMember.matrix.get(), GrB_NULL));
+        std::vector<person_score_type> ranking = input.caches.tagRanking.enabled()
+                                                 ? cached_ranking(tag_index)
+                                                 : compute_ranking(tag_index, topKLimit);
 
-        // transform relevant_persons vec. to array
-        GrB_Index relevant_persons_nvals;
-        ok(GrB_Vector_nvals(&relevant_persons_nvals, relevant_persons.get()));
-        std::vector<GrB_Index> relevant_person_indices(relevant_persons_nvals);
-        {
-            GrB_Index nvals_out = relevant_persons_nvals;
-            ok(GrB_Vector_extractTuples_BOOL(relevant_person_indices.data(), nullptr, &nvals_out,
-                                             relevant_persons.get()));
-            assert(relevant_persons_nvals == nvals_out);
-        }
+        return formatRanking(ranking);
+    }
 
-        // extract member_friends submatrix
-        GBxx_Object<GrB_Matrix> member_friends = GB(GrB_Matrix_new, GrB_BOOL,
-                                                    relevant_persons_nvals, relevant_persons_nvals);
-        ok(GrB_Matrix_extract(member_friends.get(), GrB_NULL, GrB_NULL, input.knows.matrix.get(),
-                              relevant_person_indices.data(), relevant_person_indices.size(),
-                              relevant_person_indices.data(), relevant_person_indices.size(), GrB_NULL));
+public:
+    /// \return the cached ranking of the tag if it answers k, otherwise nullptr
+    static std::shared_ptr<TagRanking const> findCachedRanking(QueryCaches &caches, GrB_Index tag_index, int k) {
+        return caches.tagRanking.find(tag_index, [k](auto const &value) {
+            return value->k >= uint64_t(k) || value->complete();
+        }).value_or(nullptr);
+    }
+
+    /// Raises the largest k seen so far to k.
+    /// \return k of a ranking to compute for the cache, the largest k seen so far
+    static int cachedRankingK(QueryCaches &caches, int k) {
+        int max_k = caches.tagRankingMaxK.load();
+        while (max_k < k && !caches.tagRankingMaxK.compare_exchange_weak(max_k, k));
+        return std::max(max_k, k);
+    }
+
+    /// Members ordered by closeness centrality (DESC) and person ID (ASC), the first k of them.
+    /// \param member_friends subgraph of knows induced by the members
+    /// \param relevant_person_indices person indices of the vertices of member_friends
+    static std::vector<person_score_type> rankMembers(BenchmarkParameters const &benchmark_parameters,
+                                                      QueryInput const &input, CsrGraph const &member_friends,
+                                                      std::vector<GrB_Index> const &relevant_person_indices,
+                                                      int k) {
+        GrB_Index relevant_persons_nvals = relevant_person_indices.size();
 
         // call MSBFS-based closeness centrality value computation
         // TODO: free mapping
-        auto[ccv, mapping] = compute_ccv(member_friends.get());
-//        auto [ccv, mapping] = compute_ccv_bool(member_friends.get());
+        // the native and approximate kernels stop traversing from persons which cannot get into the top list
+        bool approximate = benchmark_parameters.Q4ApproximateError > 0;
+        std::string kernel = approximate ? "approximate"
+                                         : choose_ccv_kernel(benchmark_parameters.CcvKernel, relevant_persons_nvals,
+                                                             benchmark_parameters.CcvBoolMaxSize);
+        // traversals from every member, the kernels take their threads from GlobalNThreads
+        ThreadsScope threads{phase_threads(benchmark_parameters, "Q4 closeness",
+                                           relevant_persons_nvals * (relevant_persons_nvals +
+                                                                     member_friends.neighbors.size()))};
+        TRACE_PHASES();
+        TRACE_PHASE("q4 closeness", kernel + ", members: " + std::to_string(relevant_persons_nvals));
+        CcvStats stats;
+        auto[ccv, mapping] = compute_ccv_by_kernel(kernel, member_friends, k, benchmark_parameters, &stats);
 
         // extract tuples from ccv result
         GrB_Index ccv_nvals;
@@ -67,15 +128,23 @@ class Query4 : public Query<int, std::string> {
 //            assert(relevant_persons_nvals == nvals_out); // TODO: what does happen if a person doesn't have CCV?
         }
 
+        if (benchmark_parameters.PrintStats) {
+            std::cerr << "Q4 closeness: members: " << relevant_persons_nvals
+                      << ", exact values: " << ccv_nvals;
+            if (approximate)
+                std::cerr << ", sampled sources: " << stats.samples << ", verified candidates: " << stats.verified;
+            std::cerr << std::endl;
+        }
+
+        TRACE_PHASE("q4 top-k");
         // define comparator for top scores
-        using person_score_type = std::tuple<double, uint64_t>;
         // use a comparator which transforms the value for comparison
         auto comparator = transformComparator([](const auto &val) {
             return std::make_tuple(
                     -std::get<0>(val),  // score DESC
                     std::get<1>(val));  // person_id ASC
         });
-        auto person_scores = makeSmallestElementsContainer<person_score_type>(topKLimit, comparator);
+        auto person_scores = makeSmallestElementsContainer<person_score_type>(k, comparator);
 
         // collect top scores
         for (size_t i = 0; i < cc_values.size(); ++i) {
@@ -88,9 +157,14 @@ class Query4 : public Query<int, std::string> {
             person_scores.add({score, person_id});
         }
 
+        return person_scores.removeElements();
+    }
+
+    /// Person IDs as result, closeness centrality values as comment.
+    static std::tuple<std::string, std::string> formatRanking(std::vector<person_score_type> const &ranking) {
         std::string result, comment;
         bool firstIter = true;
-        for (auto[score, person_id]: person_scores.removeElements()) {
+        for (auto[score, person_id]: ranking) {
             if (firstIter)
                 firstIter = false;
             else {
@@ -105,7 +179,38 @@ class Query4 : public Query<int, std::string> {
         return {result, comment};
     }
 
-public:
+    /// Subgraph of knows induced by the members of the forums having the tag.
+    /// \param relevant_person_indices person indices of the vertices of the subgraph
+    static CsrGraph memberFriends(QueryInput const &input, GrB_Index tag_index,
+                                std::vector<GrB_Index> &relevant_person_indices) {
+        TRACE_PHASES();
+        TRACE_PHASE("q4 members");
+        // hasTag
+        GBxx_Object<GrB_Vector> relevant_forums = GB(GrB_Vector_new, GrB_BOOL, input.forums.size());
+        ok(GrB_Col_extract(relevant_forums.get(), GrB_NULL, GrB_NULL,
+                           input.hasTag.matrix.get(), GrB_ALL, 0,
+                           tag_index, GrB_NULL));
+        // hasMember
+        GBxx_Object<GrB_Vector> relevant_persons = GB(GrB_Vector_new, GrB_BOOL, input.persons.size());
+        ok(GrB_vxm(relevant_persons.get(), GrB_NULL, GrB_NULL,
+                   GxB_LOR_LAND_BOOL, relevant_forums.get(), input.hasMember.matrix.get(), GrB_NULL));
+
+        // transform relevant_persons vec. to array
+        GrB_Index relevant_persons_nvals;
+        ok(GrB_Vector_nvals(&relevant_persons_nvals, relevant_persons.get()));
+        relevant_person_indices.resize(relevant_persons_nvals);
+        {
+            GrB_Index nvals_out = relevant_persons_nvals;
+            ok(GrB_Vector_extractTuples_BOOL(relevant_person_indices.data(), nullptr, &nvals_out,
+                                             relevant_persons.get()));
+            assert(relevant_persons_nvals == nvals_out);
+        }
+
+        // extract member_friends subgraph, indices are sorted
+        TRACE_PHASE("q4 induced subgraph");
+        return input.knowsGraph.inducedSubgraph(relevant_person_indices);
+    }
+
     int getQueryId() const override {
         return 4;
     }
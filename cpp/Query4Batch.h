@@ -0,0 +1,211 @@
+#pragma once
+
+#include <chrono>
+#include <exception>
+#include <map>
+#include "Query4.h"
+
+/// Runs the Query4 lines of a parameter file together. Repeated tags are ranked once with their largest k.
+/// With Q4CacheBudget, tags answered by the ranking cache are not ranked, the others are ranked up to the largest k
+/// seen so far and inserted into it.
+/// Tags are independent, so their member subgraphs are extracted and ranked concurrently: small ones as OpenMP tasks
+/// by one thread each (parallel regions nested in them are inactive), large ones one after the other by all threads.
+/// With QueryTimeout, the extraction and ranking of each tag has that deadline, the lines of a tag past it are reported
+/// with result timeout.
+class Query4Batch : public BaseQuery {
+    BenchmarkParameters const &benchmarkParameters;
+    std::vector<Query4::ParameterType> queryParams;
+    QueryInput const &input;
+    /// stream of the report of each line (empty: ReportStream)
+    std::vector<std::ostream *> reportStreams;
+
+    /// tags with at least this many members are ranked using all threads
+    static constexpr GrB_Index LargeTagSize = 4096;
+
+    struct TagTask {
+        GrB_Index tagIndex;
+        int k = 0;
+        std::vector<GrB_Index> memberIndices;
+        CsrGraph memberFriends;
+        std::vector<Query4::person_score_type> ranking;
+        /// the ranking is taken from the cache
+        bool cached = false;
+        bool timedOut = false;
+        /// cache lookup, extraction and ranking
+        std::chrono::nanoseconds runtime{0};
+    };
+
+    /// Runs function with the deadline of the task: QueryTimeout less its runtime so far.
+    template<typename Function>
+    void run_timed(TagTask &task, Function function) const {
+        using namespace std::chrono;
+        auto start = high_resolution_clock::now();
+        try {
+            DeadlineScope deadline{benchmarkParameters.QueryTimeout == 0
+                                   ? steady_clock::time_point::max()
+                                   : steady_clock::now() + milliseconds{benchmarkParameters.QueryTimeout} -
+                                     task.runtime};
+            function();
+        } catch (QueryTimeoutError const &) {
+            task.timedOut = true;
+        }
+        task.runtime += round<nanoseconds>(high_resolution_clock::now() - start);
+    }
+
+    void rank(TagTask &task) const {
+        if (!task.timedOut)
+            run_timed(task, [&]() {
+                task.ranking = Query4::rankMembers(benchmarkParameters, input, task.memberFriends,
+                                                   task.memberIndices, task.k);
+                if (input.caches.tagRanking.enabled())
+                    input.caches.tagRanking.insert(task.tagIndex, std::make_shared<TagRanking const>(
+                            TagRanking{uint64_t(task.k), task.ranking}));
+            });
+        // the subgraph is not needed anymore
+        task.memberFriends = CsrGraph{};
+    }
+
+public:
+    Query4Batch(BenchmarkParameters const &benchmark_parameters, std::vector<Query4::ParameterType> query_params,
+                QueryInput const &input, std::vector<std::ostream *> report_streams = {})
+            : benchmarkParameters{benchmark_parameters}, queryParams{std::move(query_params)}, input(input),
+              reportStreams{std::move(report_streams)} {
+        if (!reportStreams.empty() && reportStreams.size() != queryParams.size())
+            throw std::invalid_argument{"Query4Batch needs a report stream for each line"};
+    }
+
+    int getQueryId() const override {
+        return 4;
+    }
+
+    /// Reports the result of each line in order with the runtime of its tag,
+    /// then the aggregate throughput to stderr.
+    /// \return results of the lines separated by newlines
+    std::tuple<std::string, std::string> initial() override {
+        using namespace std::chrono;
+        // collections might still be loading
+        input.waitForCollectionsOf(4);
+        auto batch_start = high_resolution_clock::now();
+        TRACE_SCOPE("q4 batch", std::to_string(queryParams.size()) + " lines");
+
+        // deduplicate tags
+        std::vector<TagTask> tasks;
+        std::vector<size_t> task_of_query;
+        {
+            std::map<std::string, size_t> task_of_tag;
+            for (auto const &[k, tag_name] : queryParams) {
+                auto[it, inserted] = task_of_tag.emplace(tag_name, tasks.size());
+                if (inserted) {
+                    tasks.emplace_back();
+                    tasks.back().tagIndex = input.tags.findIndexByName(tag_name);
+                }
+                tasks[it->second].k = std::max(tasks[it->second].k, k);
+                task_of_query.push_back(it->second);
+            }
+        }
+
+        // tags to rank
+        std::vector<size_t> order;
+        for (size_t i = 0; i < tasks.size(); ++i) {
+            TagTask &task = tasks[i];
+            if (input.caches.tagRanking.enabled()) {
+                run_timed(task, [&]() {
+                    if (auto ranking = Query4::findCachedRanking(input.caches, task.tagIndex, task.k)) {
+                        task.ranking = ranking->ranking;
+                        task.cached = true;
+                    } else
+                        task.k = Query4::cachedRankingK(input.caches, task.k);
+                });
+                if (task.cached)
+                    continue;
+            }
+            order.push_back(i);
+        }
+
+        int nthreads = std::max(GlobalNThreads, 1);
+        std::exception_ptr error;
+        auto record_error = [&]() {
+#pragma omp critical(Q4_batch_error)
+            if (!error)
+                error = std::current_exception();
+        };
+
+#pragma omp parallel for num_threads(nthreads) schedule(dynamic, 1)
+        for (size_t o = 0; o < order.size(); ++o) {
+            try {
+                // each tag is extracted by one thread, not by the threads of the process
+                ThreadsScope threads{1};
+                TagTask &task = tasks[order[o]];
+                run_timed(task, [&]() {
+                    task.memberFriends = Query4::memberFriends(input, task.tagIndex, task.memberIndices);
+                });
+            } catch (...) {
+                record_error();
+            }
+        }
+        if (error)
+            std::rethrow_exception(error);
+
+        // largest tags first, so the small ones balance the load at the end
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return tasks[a].memberIndices.size() > tasks[b].memberIndices.size();
+        });
+        size_t large_tags = std::partition_point(order.begin(), order.end(), [&](size_t i) {
+            return tasks[i].memberIndices.size() >= LargeTagSize;
+        }) - order.begin();
+
+        for (size_t o = 0; o < large_tags; ++o)
+            rank(tasks[order[o]]);
+
+#pragma omp parallel num_threads(nthreads)
+#pragma omp single
+        for (size_t o = large_tags; o < order.size(); ++o) {
+            size_t i = order[o];
+#pragma omp task firstprivate(i)
+            try {
+                // each small tag is ranked by one thread, not by the threads of the process
+                ThreadsScope threads{1};
+                rank(tasks[i]);
+            } catch (...) {
+                record_error();
+            }
+        }
+        if (error)
+            std::rethrow_exception(error);
+
+        std::string results;
+        for (size_t q = 0; q < queryParams.size(); ++q) {
+            TagTask const &task = tasks[task_of_query[q]];
+            size_t k = std::get<0>(queryParams[q]);
+            std::vector<Query4::person_score_type> ranking{
+                    task.ranking.begin(), task.ranking.begin() + std::min(task.ranking.size(), k)};
+
+            auto result_tuple = task.timedOut
+                                ? std::make_tuple(std::string{"timeout"},
+                                                  "Exceeded " + std::to_string(benchmarkParameters.QueryTimeout) +
+                                                  " ms")
+                                : Query4::formatRanking(ranking);
+            std::ostream *report_stream = ReportStream;
+            if (!reportStreams.empty())
+                ReportStream = reportStreams[q];
+            report_result(*this, benchmarkParameters, task.runtime, result_tuple);
+            ReportStream = report_stream;
+
+            if (q != 0)
+                results += '\n';
+            results += std::get<0>(result_tuple);
+        }
+
+        auto runtime = round<microseconds>(high_resolution_clock::now() - batch_start);
+        size_t timed_out_tags = std::count_if(tasks.begin(), tasks.end(),
+                                              [](TagTask const &task) { return task.timedOut; });
+        std::cerr << "Q4 batch: queries: " << queryParams.size() << ", tags: " << tasks.size()
+                  << ", cached tags: " << tasks.size() - order.size() << ", large tags: " << large_tags
+                  << ", timed out tags: " << timed_out_tags
+                  << ", time: " << runtime.count() << " us"
+                  << ", throughput: " << queryParams.size() / std::max(duration<double>(runtime).count(), 1e-9)
+                  << " queries/s" << std::endl;
+
+        return {results, ""};
+    }
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <vector>
+#include <algorithm>
 
 /// The collection holds the k smallest elements from the elements inserted.
 /// \tparam ElementT type of elements to hold
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <immintrin.h>
+
+/// Bit set of Words 64-bit words, e.g. one bit for each source of a bit-parallel MSBFS.
+template<size_t Words>
+struct alignas(Words * sizeof(uint64_t)) BitLanes {
+    static constexpr size_t Bits = Words * 64;
+
+    uint64_t words[Words];
+
+    static BitLanes zero() {
+        return BitLanes{};
+    }
+
+    void setBit(size_t bit) {
+        words[bit / 64] |= 1UL << (bit % 64);
+    }
+
+    void clearBit(size_t bit) {
+        words[bit / 64] &= ~(1UL << (bit % 64));
+    }
+
+    bool testBit(size_t bit) const {
+        return words[bit / 64] & (1UL << (bit % 64));
+    }
+};
+
+/// Operations on lanes word by word, specialized below with SIMD registers of the lane width if the build target
+/// supports them.
+template<size_t Words>
+struct LaneOps {
+    using Lanes = BitLanes<Words>;
+
+    static Lanes bor(Lanes const &a, Lanes const &b) {
+        Lanes result;
+        for (size_t i = 0; i < Words; ++i)
+            result.words[i] = a.words[i] | b.words[i];
+        return result;
+    }
+
+    static Lanes band(Lanes const &a, Lanes const &b) {
+        Lanes result;
+        for (size_t i = 0; i < Words; ++i)
+            result.words[i] = a.words[i] & b.words[i];
+        return result;
+    }
+
+    /// a & ~b
+    static Lanes andnot(Lanes const &a, Lanes const &b) {
+        Lanes result;
+        for (size_t i = 0; i < Words; ++i)
+            result.words[i] = a.words[i] & ~b.words[i];
+        return result;
+    }
+
+    static bool isZero(Lanes const &a) {
+        uint64_t any = 0;
+        for (size_t i = 0; i < Words; ++i)
+            any |= a.words[i];
+        return any == 0;
+    }
+};
+
+#if defined(__SSE2__)
+
+template<>
+struct LaneOps<2> {
+    using Lanes = BitLanes<2>;
+
+    static __m128i load(Lanes const &a) {
+        return _mm_load_si128(reinterpret_cast<__m128i const *>(a.words));
+    }
+
+    static Lanes store(__m128i v) {
+        Lanes result;
+        _mm_store_si128(reinterpret_cast<__m128i *>(result.words), v);
+        return result;
+    }
+
+    static Lanes bor(Lanes const &a, Lanes const &b) {
+        return store(_mm_or_si128(load(a), load(b)));
+    }
+
+    static Lanes band(Lanes const &a, Lanes const &b) {
+        return store(_mm_and_si128(load(a), load(b)));
+    }
+
+    /// a & ~b
+    static Lanes andnot(Lanes const &a, Lanes const &b) {
+        return store(_mm_andnot_si128(load(b), load(a)));
+    }
+
+    static bool isZero(Lanes const &a) {
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(load(a), _mm_setzero_si128())) == 0xFFFF;
+    }
+};
+
+#endif
+
+#if defined(__AVX2__)
+
+template<>
+struct LaneOps<4> {
+    using Lanes = BitLanes<4>;
+
+    static __m256i load(Lanes const &a) {
+        return _mm256_load_si256(reinterpret_cast<__m256i const *>(a.words));
+    }
+
+    static Lanes store(__m256i v) {
+        Lanes result;
+        _mm256_store_si256(reinterpret_cast<__m256i *>(result.words), v);
+        return result;
+    }
+
+    static Lanes bor(Lanes const &a, Lanes const &b) {
+        return store(_mm256_or_si256(load(a), load(b)));
+    }
+
+    static Lanes band(Lanes const &a, Lanes const &b) {
+        return store(_mm256_and_si256(load(a), load(b)));
+    }
+
+    /// a & ~b
+    static Lanes andnot(Lanes const &a, Lanes const &b) {
+        return store(_mm256_andnot_si256(load(b), load(a)));
+    }
+
+    static bool isZero(Lanes const &a) {
+        __m256i v = load(a);
+        return _mm256_testz_si256(v, v);
+    }
+};
+
+#endif
+
+#if defined(__AVX512F__)
+
+template<>
+struct LaneOps<8> {
+    using Lanes = BitLanes<8>;
+
+    static __m512i load(Lanes const &a) {
+        return _mm512_load_si512(a.words);
+    }
+
+    static Lanes store(__m512i v) {
+        Lanes result;
+        _mm512_store_si512(result.words, v);
+        return result;
+    }
+
+    static Lanes bor(Lanes const &a, Lanes const &b) {
+        return store(_mm512_or_si512(load(a), load(b)));
+    }
+
+    static Lanes band(Lanes const &a, Lanes const &b) {
+        return store(_mm512_and_si512(load(a), load(b)));
+    }
+
+    /// a & ~b
+    static Lanes andnot(Lanes const &a, Lanes const &b) {
+        return store(_mm512_andnot_si512(load(b), load(a)));
+    }
+
+    static bool isZero(Lanes const &a) {
+        return _mm512_test_epi64_mask(load(a), load(a)) == 0;
+    }
+};
+
+#endif
+
+/// Widest lanes backed by a SIMD register of the build target.
+#if defined(__AVX512F__)
+constexpr size_t NativeLaneBits = 512;
+#elif defined(__AVX2__)
+constexpr size_t NativeLaneBits = 256;
+#elif defined(__SSE2__)
+constexpr size_t NativeLaneBits = 128;
+#else
+constexpr size_t NativeLaneBits = 64;
+#endif
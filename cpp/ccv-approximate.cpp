@@ -0,0 +1,203 @@
+#include "ccv-approximate.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <random>
+
+namespace {
+
+/// Queue-based BFS reusing its buffers between traversals.
+class Bfs {
+    static constexpr uint32_t Unreached = std::numeric_limits<uint32_t>::max();
+
+    std::vector<uint32_t> distances;
+    std::vector<CsrGraph::Vertex> queue;
+
+public:
+    explicit Bfs(GrB_Index n) : distances(n, Unreached) {}
+
+    /// Vertices reached from source in BFS order, valid until the next traversal.
+    std::vector<CsrGraph::Vertex> const &run(CsrGraph const &graph, GrB_Index source) {
+        for (CsrGraph::Vertex v : queue)
+            distances[v] = Unreached;
+        queue.clear();
+
+        distances[source] = 0;
+        queue.push_back(source);
+        for (size_t i = 0; i < queue.size(); ++i) {
+            CsrGraph::Vertex v = queue[i];
+            uint32_t next_distance = distances[v] + 1;
+            for (auto it = graph.neighborsBegin(v), end = graph.neighborsEnd(v); it != end; ++it)
+                if (distances[*it] == Unreached) {
+                    distances[*it] = next_distance;
+                    queue.push_back(*it);
+                }
+        }
+        return queue;
+    }
+
+    uint32_t distance(GrB_Index vertex) const {
+        return distances[vertex];
+    }
+};
+
+/// Sources to sample from a component: by Hoeffding's inequality and the union bound over its vertices,
+/// all average distances are estimated within error * range with probability confidence.
+GrB_Index sample_count(GrB_Index compsize, double error, double confidence) {
+    double samples = std::ceil(std::log(2.0 * compsize / (1.0 - confidence)) / (2.0 * error * error));
+    return samples < compsize ? GrB_Index(samples) : compsize;
+}
+
+}
+
+std::tuple<GBxx_Object<GrB_Vector>, std::unique_ptr<GrB_Index[]>> compute_ccv_approximate_topk(
+        CsrGraph const &graph, uint64_t k, double error, double confidence, CcvStats *stats) {
+    GrB_Index const n = graph.size();
+
+    // singletons have no value
+    std::vector<std::vector<GrB_Index>> components = graph.connectedComponents();
+    components.erase(std::remove_if(components.begin(), components.end(),
+                                    [](auto const &component) { return component.size() < 2; }),
+                     components.end());
+
+    std::vector<GrB_Index> sample_counts(components.size());
+    std::vector<GrB_Index> sources;
+    std::vector<uint32_t> source_components;
+    std::vector<bool> sampled(n, false);
+    for (size_t c = 0; c < components.size(); ++c) {
+        auto const &component = components[c];
+        sample_counts[c] = sample_count(component.size(), error, confidence);
+
+        // seeded by the component for reproducible results
+        size_t first_source = sources.size();
+        std::mt19937_64 random_engine{component.front()};
+        std::sample(component.begin(), component.end(), std::back_inserter(sources), sample_counts[c],
+                    random_engine);
+        for (size_t s = first_source; s < sources.size(); ++s) {
+            sampled[sources[s]] = true;
+            source_components.push_back(c);
+        }
+    }
+
+    // sum of distances from the sources of its component to each vertex, largest distance found in each component
+    int nthreads = std::max(GlobalNThreads, 1);
+    std::vector<uint64_t> distance_sums(n, 0);
+    std::vector<uint32_t> eccentricities(components.size(), 0);
+    auto deadline = QueryDeadline;
+#pragma omp parallel num_threads(nthreads)
+    {
+        DeadlineScope deadline_scope{deadline};
+        Bfs bfs{n};
+        std::vector<uint64_t> local_distance_sums(n, 0);
+        std::vector<uint32_t> local_eccentricities(components.size(), 0);
+
+#pragma omp for schedule(dynamic, 1)
+        for (size_t s = 0; s < sources.size(); ++s) {
+            // skip the remaining sources, the timeout is thrown after the parallel region
+            if (deadline_passed())
+                continue;
+            auto const &reached = bfs.run(graph, sources[s]);
+            for (CsrGraph::Vertex v : reached)
+                local_distance_sums[v] += bfs.distance(v);
+            uint32_t &eccentricity = local_eccentricities[source_components[s]];
+            eccentricity = std::max(eccentricity, bfs.distance(reached.back()));
+        }
+
+#pragma omp critical(ccv_approximate_merge)
+        {
+            for (GrB_Index v = 0; v < n; ++v)
+                distance_sums[v] += local_distance_sums[v];
+            for (size_t c = 0; c < components.size(); ++c)
+                eccentricities[c] = std::max(eccentricities[c], local_eccentricities[c]);
+        }
+    }
+    check_deadline();
+
+    // bounds of the values
+    //
+    //          (C(p)-1)^2      C(p)-1
+    // CCV(p) = ---------- = ------------ where a(p) is the average distance to the other vertices of the component
+    //          (n-1)*s(p)   (n-1) * a(p)
+    std::vector<GrB_Index> exact_indices, candidate_indices;
+    std::vector<double> exact_values, lower_bounds;
+    std::vector<std::tuple<GrB_Index, double>> upper_bounds;
+    for (size_t c = 0; c < components.size(); ++c) {
+        GrB_Index const compsize = components[c].size();
+
+        if (sample_counts[c] == compsize) {
+            // every vertex was a source
+            for (GrB_Index v : components[c]) {
+                exact_indices.push_back(v);
+                exact_values.push_back(closeness_value(n, compsize, distance_sums[v]));
+                lower_bounds.push_back(exact_values.back());
+            }
+            continue;
+        }
+
+        // no distance in the component exceeds twice the eccentricity of any of its vertices
+        double const diameter_bound = 2.0 * eccentricities[c];
+        for (GrB_Index v : components[c]) {
+            GrB_Index other_sources = sample_counts[c] - (sampled[v] ? 1 : 0);
+            double average_low = 1.0, average_high = diameter_bound;
+            if (other_sources != 0) {
+                double average = double(distance_sums[v]) / double(other_sources);
+                average_low = std::max(average_low, average - error * diameter_bound);
+                average_high = std::min(average_high, average + error * diameter_bound);
+            }
+
+            lower_bounds.push_back(double(compsize - 1) / (double(n - 1) * average_high));
+            upper_bounds.emplace_back(v, double(compsize - 1) / (double(n - 1) * average_low));
+        }
+    }
+
+    // vertices whose upper bound does not reach the k-th best lower bound cannot be among the top k
+    double kth_lower_bound = -std::numeric_limits<double>::infinity();
+    if (k != 0 && lower_bounds.size() >= k) {
+        std::nth_element(lower_bounds.begin(), lower_bounds.begin() + (k - 1), lower_bounds.end(),
+                         std::greater<>{});
+        kth_lower_bound = lower_bounds[k - 1];
+    }
+    for (auto const &[v, upper_bound] : upper_bounds)
+        if (upper_bound >= kth_lower_bound)
+            candidate_indices.push_back(v);
+
+    // exact values of the candidates
+    std::vector<double> candidate_values(candidate_indices.size());
+#pragma omp parallel num_threads(nthreads)
+    {
+        DeadlineScope deadline_scope{deadline};
+        Bfs bfs{n};
+
+#pragma omp for schedule(dynamic, 1)
+        for (size_t i = 0; i < candidate_indices.size(); ++i) {
+            if (deadline_passed())
+                continue;
+            auto const &reached = bfs.run(graph, candidate_indices[i]);
+            uint64_t sp = 0;
+            for (CsrGraph::Vertex v : reached)
+                sp += bfs.distance(v);
+            candidate_values[i] = closeness_value(n, reached.size(), sp);
+        }
+    }
+    check_deadline();
+
+    if (stats) {
+        uint32_t levels = 0;
+        for (uint32_t eccentricity : eccentricities)
+            levels = std::max(levels, eccentricity);
+
+        // distances and queue of the traversals, sums of distances of each thread
+        uint64_t thread_bytes = n * (2 * sizeof(uint32_t) + sizeof(uint64_t));
+        uint64_t graph_bytes = graph.offsets.size() * sizeof(GrB_Index) +
+                               graph.neighbors.size() * sizeof(CsrGraph::Vertex);
+        *stats = CcvStats{levels, graph_bytes + nthreads * thread_bytes, sources.size(), candidate_indices.size()};
+    }
+
+    exact_indices.insert(exact_indices.end(), candidate_indices.begin(), candidate_indices.end());
+    exact_values.insert(exact_values.end(), candidate_values.begin(), candidate_values.end());
+    return std::tuple<GBxx_Object<GrB_Vector>, std::unique_ptr<GrB_Index[]>>{
+            build_ccv_vector(n, exact_indices, exact_values), nullptr};
+}
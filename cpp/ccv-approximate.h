@@ -0,0 +1,16 @@
+#pragma once
+
+#include <vector>
+#include "gb_utils.h"
+#include "csr.h"
+#include "ccv.h"
+
+/// Closeness centrality values of the vertices which might be among the k most central ones, estimated by sampling.
+///
+/// In each component, sum of distances is estimated from BFS traversals of uniformly sampled sources. With enough
+/// samples (Hoeffding), every estimated average distance is within error * (upper bound of the diameter) of the exact
+/// one with the given confidence. Vertices whose upper bound of the value reaches the k-th best lower bound are
+/// candidates, their values are computed exactly, others are omitted from the result. Values of components with
+/// at most as many vertices as samples needed are exact anyway.
+std::tuple<GBxx_Object<GrB_Vector>, std::unique_ptr<GrB_Index[]>> compute_ccv_approximate_topk(
+        CsrGraph const &graph, uint64_t k, double error, double confidence, CcvStats *stats = nullptr);
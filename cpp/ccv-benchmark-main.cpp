@@ -0,0 +1,129 @@
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string_view>
+#include <omp.h>
+#include "gb_utils.h"
+#include "utils.h"
+#include "Query4.h"
+
+// Runs every closeness centrality kernel on the member subgraphs of the Query4 parameters
+// and prints a CSV line per tag and kernel: time, BFS levels, estimated peak memory of the traversal state (CcvStats)
+// and measured peak growth of the resident set size.
+
+/// Tags and the largest k of the Query4 lines in the parameter file.
+std::map<std::string, int> read_query4_tags(std::string const &path) {
+    using namespace std::literals;
+    std::map<std::string, int> tags;
+
+    io::LineReader in(path);
+    while (char *line = in.next_line()) {
+        std::string_view line_sv{line};
+        if (line_sv.substr(0, "query4("sv.length()) != "query4("sv)
+            continue;
+
+        line_sv.remove_prefix("query4("sv.length());
+        line_sv.remove_suffix(")"sv.length());
+        size_t delimiter = line_sv.find(", "sv);
+
+        int k = std::stoi(std::string{line_sv.substr(0, delimiter)});
+        std::string tag{line_sv.substr(delimiter + ", "sv.length())};
+        tags[tag] = std::max(tags[tag], k);
+    }
+    return tags;
+}
+
+/// Field of /proc/self/status in bytes, e.g. "VmRSS:" or its peak "VmHWM:", 0 if unavailable.
+uint64_t proc_status_bytes(std::string const &field) {
+    std::ifstream status{"/proc/self/status"};
+    for (std::string line; std::getline(status, line);)
+        if (line.compare(0, field.size(), field) == 0)
+            return std::stoull(line.substr(field.size())) * 1024;
+    return 0;
+}
+
+/// Resets the peak resident set size (VmHWM) to the current one.
+/// \return false if the kernel does not support it
+bool reset_peak_rss() {
+    std::ofstream clear_refs{"/proc/self/clear_refs"};
+    clear_refs << "5" << std::flush;
+    return bool(clear_refs);
+}
+
+int main(int argc, char *argv[]) {
+    BenchmarkParameters parameters = parse_benchmark_params(argc, argv);
+    // load the inputs of Query4 only
+    parameters.Query = 4;
+
+    ok(LAGraph_init());
+
+    if (parameters.ThreadsNum > 0)
+        LAGraph_set_nthreads(parameters.ThreadsNum);
+    ProcessNThreads = GlobalNThreads = LAGraph_get_nthreads();
+    std::cerr << "Threads: " << GlobalNThreads << '/' << omp_get_max_threads() << std::endl;
+
+    auto tags = read_query4_tags(parameters.ParamsPath + "query4.txt");
+    QueryInput input{parameters};
+
+    std::cout << "tag,members,edges,kernel,time_us,levels,estimated_peak_bytes,measured_peak_bytes,values"
+              << std::endl;
+    for (auto const &[tag_name, k] : tags) {
+        std::vector<GrB_Index> member_indices;
+        CsrGraph member_friends = Query4::memberFriends(input, input.tags.findIndexByName(tag_name),
+                                                        member_indices);
+        GrB_Index edges = member_friends.neighbors.size();
+
+        GBxx_Object<GrB_Vector> reference;
+        for (char const *kernel : CcvKernelNames) {
+            using namespace std::chrono;
+            using namespace std::literals;
+            CcvStats stats;
+            bool peak_reset = reset_peak_rss();
+            uint64_t rss_before = proc_status_bytes("VmRSS:");
+            auto start = high_resolution_clock::now();
+            auto[ccv, mapping] = compute_ccv_by_kernel(kernel, member_friends, k, parameters, &stats);
+            auto runtime = round<microseconds>(high_resolution_clock::now() - start);
+            uint64_t peak_rss = proc_status_bytes("VmHWM:");
+
+            GrB_Index ccv_nvals;
+            ok(GrB_Vector_nvals(&ccv_nvals, ccv.get()));
+            std::cout << tag_name << CSV_SEPARATOR << member_indices.size() << CSV_SEPARATOR << edges
+                      << CSV_SEPARATOR << kernel << CSV_SEPARATOR << runtime.count()
+                      << CSV_SEPARATOR << stats.levels << CSV_SEPARATOR << stats.peakBytes << CSV_SEPARATOR;
+            // empty if the peak could not be reset, memory reused from the allocator is not counted
+            if (peak_reset && peak_rss != 0)
+                std::cout << std::max(peak_rss, rss_before) - rss_before;
+            std::cout << CSV_SEPARATOR << ccv_nvals << std::endl;
+
+            // values of every kernel should be identical to the first one (the native kernel omits some)
+            if (!reference) {
+                reference = std::move(ccv);
+                continue;
+            }
+            GrB_Index reference_nvals;
+            ok(GrB_Vector_nvals(&reference_nvals, reference.get()));
+            if (kernel != "native"sv && ccv_nvals != reference_nvals)
+                throw std::runtime_error{"Closeness values of kernel " + std::string{kernel} +
+                                         " are missing for tag " + tag_name};
+
+            std::vector<GrB_Index> indices(ccv_nvals);
+            std::vector<double> values(ccv_nvals);
+            {
+                GrB_Index nvals_out = ccv_nvals;
+                ok(GrB_Vector_extractTuples_FP64(indices.data(), values.data(), &nvals_out, ccv.get()));
+            }
+            for (size_t i = 0; i < indices.size(); ++i) {
+                double reference_value;
+                if (GrB_Vector_extractElement_FP64(&reference_value, reference.get(), indices[i]) != GrB_SUCCESS ||
+                    reference_value != values[i])
+                    throw std::runtime_error{"Closeness values of kernel " + std::string{kernel} +
+                                             " mismatch for tag " + tag_name};
+            }
+        }
+    }
+
+    ok(LAGraph_finalize());
+
+    return 0;
+}
@@ -1,4 +1,4 @@
-#include "ccv.h"
+#include "ccv-bool.h"
 #include "assert.h"
 
 
@@ -10,9 +10,7 @@ void create_diagonal_matrix(GrB_Matrix D) {
     std::unique_ptr<GrB_Index[]> I{new GrB_Index[n]};
     std::unique_ptr<bool[]> X{new bool[n]};
 
-    int nthreads = GlobalNThreads;
-    nthreads = std::min<size_t>(n / 4096, nthreads);
-    nthreads = std::max(nthreads, 1);
+    int nthreads = threads_for(n);
 #pragma omp parallel for num_threads(nthreads) schedule(static)
     for (GrB_Index k = 0; k < n; k++) {
         I[k] = k;
@@ -22,7 +20,7 @@ void create_diagonal_matrix(GrB_Matrix D) {
 }
 
 // TODO: mapping comes from LAGraph (C code) and needs to be freed
-std::tuple<GBxx_Object<GrB_Vector>, std::unique_ptr<GrB_Index[]>> compute_ccv_bool(GrB_Matrix A) {
+std::tuple<GBxx_Object<GrB_Vector>, std::unique_ptr<GrB_Index[]>> compute_ccv_bool(GrB_Matrix A, CcvStats *stats) {
     // initializing unary operator for nextCount
 
     GrB_Index n;
@@ -62,6 +60,10 @@ std::tuple<GBxx_Object<GrB_Vector>, std::unique_ptr<GrB_Index[]>> compute_ccv_bo
 //    LAGraph_reorder_vertices(&C, &mapping, A, false);
 //    A = C;
 
+    // seen and next hold BOOL values and indices
+    GrB_Index const bytes_per_entry = sizeof(bool) + sizeof(GrB_Index);
+    GrB_Index levels = 0, peak_nvals = 0;
+
     // traversal
     for (GrB_Index level = 1; level < n; level++) {
 //        printf("========================= Level %2ld =========================\n\n", level);
@@ -81,6 +83,13 @@ std::tuple<GBxx_Object<GrB_Vector>, std::unique_ptr<GrB_Index[]>> compute_ccv_bo
         // seen = seen | next
         ok(GrB_Matrix_eWiseAdd_BinaryOp(seen.get(), NULL, NULL, GrB_LOR, seen.get(), next.get(), NULL));
 
+        if (stats) {
+            GrB_Index seen_nvals;
+            ok(GrB_Matrix_nvals(&seen_nvals, seen.get()));
+            levels = level;
+            peak_nvals = std::max(peak_nvals, seen_nvals + next_nvals);
+        }
+
         // sp += (nextCount * level)
         //   nextCount * level is expressed as nextCount *= level_v
         ok(GrB_Vector_apply_BinaryOp1st_UINT64(nextCount.get(), NULL, NULL, GrB_TIMES_UINT64, level, nextCount.get(), NULL));
@@ -104,5 +113,8 @@ std::tuple<GBxx_Object<GrB_Vector>, std::unique_ptr<GrB_Index[]>> compute_ccv_bo
     ok(GrB_Vector_apply_BinaryOp2nd_UINT64(sp.get(), NULL, NULL, GrB_TIMES_UINT64, sp.get(), n-1, NULL));
     ok(GrB_Vector_eWiseMult_BinaryOp(ccv_result.get(), NULL, NULL, GrB_DIV_FP64, compsize.get(), sp.get(), NULL));
 
+    if (stats)
+        *stats = CcvStats{levels, peak_nvals * bytes_per_entry};
+
     return std::tuple<GBxx_Object<GrB_Vector>, std::unique_ptr<GrB_Index[]>>{std::move(ccv_result), nullptr};
 }
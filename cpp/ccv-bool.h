@@ -1,5 +1,7 @@
 #pragma once
 
 #include "gb_utils.h"
+#include "ccv.h"
 
-std::tuple<GBxx_Object<GrB_Vector>, std::unique_ptr<GrB_Index[]>> compute_ccv_bool(GrB_Matrix A);
+std::tuple<GBxx_Object<GrB_Vector>, std::unique_ptr<GrB_Index[]>> compute_ccv_bool(GrB_Matrix A,
+                                                                                  CcvStats *stats = nullptr);
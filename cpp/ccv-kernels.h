@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <stdexcept>
+#include "ccv.h"
+#include "ccv-bool.h"
+#include "ccv-native.h"
+#include "ccv-approximate.h"
+
+/// Closeness centrality kernels selectable by the CcvKernel option, "auto" chooses one of them.
+inline char const *const CcvKernelNames[] = {"graphblas", "bool", "native"};
+
+/// Resolve "auto" by the number of vertices: the boolean n*n matrices only win on tiny subgraphs.
+inline std::string choose_ccv_kernel(std::string const &kernel, GrB_Index n, uint64_t bool_max_size) {
+    if (kernel != "auto")
+        return kernel;
+    return n <= bool_max_size ? "bool" : "native";
+}
+
+/// Closeness centrality values of the vertices of graph computed by kernel, configured by parameters.
+/// The native and approximate kernels omit vertices which cannot be among the top k.
+inline std::tuple<GBxx_Object<GrB_Vector>, std::unique_ptr<GrB_Index[]>>
+compute_ccv_by_kernel(std::string const &kernel, CsrGraph const &graph, uint64_t k,
+                      BenchmarkParameters const &parameters, CcvStats *stats = nullptr) {
+    if (kernel == "graphblas")
+        return compute_ccv(graph.toMatrix().get(), parameters.CcvBatchSize, stats);
+    else if (kernel == "bool")
+        return compute_ccv_bool(graph.toMatrix().get(), stats);
+    else if (kernel == "native")
+        return compute_ccv_native_topk(graph, k, parameters.CcvLaneBits, stats);
+    else if (kernel == "approximate")
+        return compute_ccv_approximate_topk(graph, k, parameters.Q4ApproximateError,
+                                            parameters.Q4ApproximateConfidence, stats);
+    else
+        throw std::runtime_error{"Unknown closeness centrality kernel: " + kernel};
+}
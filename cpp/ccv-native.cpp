@@ -0,0 +1,311 @@
+#include "ccv-native.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <numeric>
+#include <queue>
+#include <string>
+#include <type_traits>
+#include <omp.h>
+#include "bit-lanes.h"
+
+namespace {
+
+// Sources of a traversal are the bits of lanes stored for each vertex (vertex-major),
+// so a level reads the lanes of the neighbors and writes the lanes of the vertex only.
+template<size_t Words>
+using Ops = LaneOps<Words>;
+
+/// Lane width for a graph: the smallest one covering all of its vertices as sources in one batch,
+/// at most the native register width, unless a width is configured (not 0).
+GrB_Index choose_lane_bits(GrB_Index n, GrB_Index configured_lane_bits) {
+    if (configured_lane_bits != 0)
+        return configured_lane_bits;
+
+    GrB_Index lane_bits = 64;
+    while (lane_bits < NativeLaneBits && lane_bits < n)
+        lane_bits *= 2;
+    return lane_bits;
+}
+
+/// Call function with the number of words of the lane width as a compile-time constant.
+template<typename Function>
+void dispatch_lane_words(GrB_Index lane_bits, Function &&function) {
+    switch (lane_bits) {
+        case 64:
+            function(std::integral_constant<size_t, 1>{});
+            break;
+        case 128:
+            function(std::integral_constant<size_t, 2>{});
+            break;
+        case 256:
+            function(std::integral_constant<size_t, 4>{});
+            break;
+        case 512:
+            function(std::integral_constant<size_t, 8>{});
+            break;
+        default:
+            throw std::runtime_error{"Unsupported lane width: " + std::to_string(lane_bits)};
+    }
+}
+
+/// seen, frontier and next lanes of each vertex
+uint64_t lanes_bytes(GrB_Index n, GrB_Index lane_bits) {
+    return 3 * n * lane_bits / 8;
+}
+
+uint64_t csr_bytes(CsrGraph const &graph) {
+    return graph.offsets.size() * sizeof(GrB_Index) + graph.neighbors.size() * sizeof(CsrGraph::Vertex);
+}
+
+/// k best exact values, shared by the traversals of components running in parallel.
+/// A vertex is pruned if its upper bound is strictly below the k-th one,
+/// so vertices tied with the k-th value are kept for the ID-based tie-break.
+class TopValues {
+    uint64_t k;
+    std::mutex mutex;
+    std::priority_queue<double, std::vector<double>, std::greater<>> values;
+    std::atomic<double> kthBest{-std::numeric_limits<double>::infinity()};
+
+public:
+    explicit TopValues(uint64_t k) : k(k) {}
+
+    double kthBestValue() const {
+        return kthBest.load(std::memory_order_relaxed);
+    }
+
+    void add(double value) {
+        if (k == 0)
+            return;
+
+        std::lock_guard<std::mutex> lock{mutex};
+        if (values.size() < k)
+            values.push(value);
+        else if (value > values.top()) {
+            values.pop();
+            values.push(value);
+        }
+
+        if (values.size() == k)
+            kthBest.store(values.top(), std::memory_order_relaxed);
+    }
+};
+
+/// Top-k closeness traversal of a connected component with at least 2 vertices.
+/// \param n number of vertices of the whole graph used for normalization
+/// \param ccv_indices indices of the component's vertices, values are appended for the ones not pruned
+/// \return deepest level
+template<size_t Words>
+uint64_t component_closeness_topk(CsrGraph const &component, GrB_Index n, TopValues &top_values, int nthreads,
+                              std::vector<GrB_Index> &ccv_indices, std::vector<double> &ccv_values) {
+    using Lanes = BitLanes<Words>;
+    GrB_Index const compsize = component.size();
+    assert(compsize > 1);
+
+    // vertices with many neighbors are likely to be central, traversing them first raises the k-th best value early
+    std::vector<GrB_Index> sources(compsize);
+    std::iota(sources.begin(), sources.end(), 0);
+    std::sort(sources.begin(), sources.end(), [&](GrB_Index a, GrB_Index b) {
+        auto degree = [&](GrB_Index v) { return component.offsets[v + 1] - component.offsets[v]; };
+        return std::make_tuple(degree(a), b) > std::make_tuple(degree(b), a);
+    });
+
+    std::vector<Lanes> seen(compsize), frontier(compsize), next(compsize);
+    std::vector<std::array<uint64_t, Lanes::Bits>> thread_reached_counts(nthreads);
+    uint64_t levels = 0;
+
+    for (GrB_Index batch_begin = 0; batch_begin < compsize; batch_begin += Lanes::Bits) {
+        GrB_Index batch_size = std::min<GrB_Index>(Lanes::Bits, compsize - batch_begin);
+        GrB_Index const *batch_sources = sources.data() + batch_begin;
+
+        // per source: number of seen vertices (including itself) and sum of their distances
+        std::array<uint64_t, Lanes::Bits> reached_counts, distance_sums;
+        reached_counts.fill(1);
+        distance_sums.fill(0);
+
+        std::fill(seen.begin(), seen.end(), Lanes::zero());
+        std::fill(frontier.begin(), frontier.end(), Lanes::zero());
+        Lanes active = Lanes::zero();
+        for (GrB_Index i = 0; i < batch_size; ++i) {
+            GrB_Index source = batch_sources[i];
+            // upper bound: every other vertex of the component is a neighbor
+            if (closeness_value(n, compsize, compsize - 1) < top_values.kthBestValue())
+                continue;
+
+            active.setBit(i);
+            seen[source].setBit(i);
+            frontier[source].setBit(i);
+        }
+
+        for (uint64_t level = 1; !Ops<Words>::isZero(active); ++level) {
+            check_deadline();
+            levels = std::max(levels, level);
+            for (auto &counts : thread_reached_counts)
+                counts.fill(0);
+
+#pragma omp parallel num_threads(nthreads)
+            {
+                auto &reached_counts_of_thread = thread_reached_counts[omp_get_thread_num()];
+
+#pragma omp for schedule(dynamic, 1024)
+                for (GrB_Index v = 0; v < compsize; ++v) {
+                    // seen by all active sources
+                    if (Ops<Words>::isZero(Ops<Words>::andnot(active, seen[v]))) {
+                        next[v] = Lanes::zero();
+                        continue;
+                    }
+
+                    Lanes reached = Lanes::zero();
+                    for (auto it = component.neighborsBegin(v), end = component.neighborsEnd(v); it != end; ++it)
+                        reached = Ops<Words>::bor(reached, frontier[*it]);
+                    reached = Ops<Words>::band(Ops<Words>::andnot(reached, seen[v]), active);
+                    next[v] = reached;
+                    seen[v] = Ops<Words>::bor(seen[v], reached);
+
+                    // count per source, pruning needs the progress of each source
+                    for (size_t word = 0; word < Words; ++word)
+                        for (uint64_t bits = reached.words[word]; bits != 0; bits &= bits - 1)
+                            ++reached_counts_of_thread[word * 64 + __builtin_ctzll(bits)];
+                }
+            }
+
+            for (GrB_Index i = 0; i < batch_size; ++i) {
+                if (!active.testBit(i))
+                    continue;
+
+                uint64_t level_count = 0;
+                for (auto const &counts : thread_reached_counts)
+                    level_count += counts[i];
+                reached_counts[i] += level_count;
+                distance_sums[i] += level * level_count;
+
+                if (reached_counts[i] == compsize) {
+                    double value = closeness_value(n, compsize, distance_sums[i]);
+                    ccv_indices.push_back(batch_sources[i]);
+                    ccv_values.push_back(value);
+                    top_values.add(value);
+                    active.clearBit(i);
+                    continue;
+                }
+
+                // upper bound: unreached vertices of the component are at least in the next level
+                uint64_t sp_lower_bound = distance_sums[i] + (compsize - reached_counts[i]) * (level + 1);
+                if (closeness_value(n, compsize, sp_lower_bound) < top_values.kthBestValue())
+                    active.clearBit(i);
+            }
+
+            std::swap(frontier, next);
+        }
+    }
+    return levels;
+}
+
+/// Components of at least this many vertices are traversed one by one using all threads,
+/// smaller ones are traversed in parallel by one thread each.
+constexpr GrB_Index LargeComponentSize = 4096;
+
+}
+
+void msbfs_closeness_native_topk(CsrGraph const &graph, uint64_t k,
+                                 std::vector<GrB_Index> &ccv_indices, std::vector<double> &ccv_values,
+                                 GrB_Index lane_bits, CcvStats *stats) {
+    GrB_Index const n = graph.size();
+    ccv_indices.clear();
+    ccv_values.clear();
+
+    // singletons have no value, large components are likely to contain the most central vertices
+    std::vector<std::vector<GrB_Index>> components = graph.connectedComponents();
+    components.erase(std::remove_if(components.begin(), components.end(),
+                                    [](auto const &component) { return component.size() < 2; }),
+                     components.end());
+    std::stable_sort(components.begin(), components.end(),
+                     [](auto const &a, auto const &b) { return a.size() > b.size(); });
+
+    int nthreads = std::max(GlobalNThreads, 1);
+    TopValues top_values{k};
+    std::mutex result_mutex;
+    CcvStats total_stats{0, csr_bytes(graph)};
+    uint64_t peak_component_bytes = 0;
+
+    auto process_component = [&](std::vector<GrB_Index> const &vertices, int component_nthreads) {
+        // upper bound of the whole component: every other vertex of it is a neighbor
+        GrB_Index compsize = vertices.size();
+        if (closeness_value(n, compsize, compsize - 1) < top_values.kthBestValue())
+            return;
+
+        CsrGraph component = graph.inducedSubgraph(vertices);
+
+        std::vector<GrB_Index> component_indices;
+        std::vector<double> component_values;
+        GrB_Index component_lane_bits = choose_lane_bits(compsize, lane_bits);
+        uint64_t levels = 0;
+        dispatch_lane_words(component_lane_bits, [&](auto words) {
+            levels = component_closeness_topk<decltype(words)::value>(component, n, top_values, component_nthreads,
+                                                                      component_indices, component_values);
+        });
+
+        std::lock_guard<std::mutex> lock{result_mutex};
+        total_stats.levels = std::max(total_stats.levels, levels);
+        peak_component_bytes = std::max(peak_component_bytes,
+                                        csr_bytes(component) + lanes_bytes(compsize, component_lane_bits));
+        for (size_t i = 0; i < component_indices.size(); ++i) {
+            ccv_indices.push_back(vertices[component_indices[i]]);
+            ccv_values.push_back(component_values[i]);
+        }
+    };
+
+    size_t large_components = std::partition_point(
+            components.begin(), components.end(),
+            [](auto const &component) { return component.size() >= LargeComponentSize; }) - components.begin();
+    for (size_t c = 0; c < large_components; ++c)
+        process_component(components[c], nthreads);
+
+    std::exception_ptr component_error;
+    auto deadline = QueryDeadline;
+#pragma omp parallel for num_threads(nthreads) schedule(dynamic, 1)
+    for (size_t c = large_components; c < components.size(); ++c) {
+        try {
+            DeadlineScope deadline_scope{deadline};
+            ThreadsScope threads{1};
+            process_component(components[c], 1);
+        } catch (...) {
+            // exceptions must not leave the parallel region
+#pragma omp critical(ccv_native_component)
+            if (!component_error)
+                component_error = std::current_exception();
+        }
+    }
+    if (component_error)
+        std::rethrow_exception(component_error);
+
+    if (stats) {
+        // small components are traversed in parallel, each by one thread
+        total_stats.peakBytes += peak_component_bytes * (large_components == components.size() ? 1 : nthreads);
+        *stats = total_stats;
+    }
+}
+
+std::tuple<GBxx_Object<GrB_Vector>, std::unique_ptr<GrB_Index[]>> compute_ccv_native_topk(CsrGraph const &graph,
+                                                                                         uint64_t k,
+                                                                                         GrB_Index lane_bits,
+                                                                                         CcvStats *stats) {
+    std::vector<GrB_Index> ccv_indices;
+    std::vector<double> ccv_values;
+    msbfs_closeness_native_topk(graph, k, ccv_indices, ccv_values, lane_bits, stats);
+
+    return std::tuple<GBxx_Object<GrB_Vector>, std::unique_ptr<GrB_Index[]>>{
+            build_ccv_vector(graph.size(), ccv_indices, ccv_values), nullptr};
+}
+
+std::tuple<GBxx_Object<GrB_Vector>, std::unique_ptr<GrB_Index[]>> compute_ccv_native_topk(GrB_Matrix A,
+                                                                                         uint64_t k,
+                                                                                         GrB_Index lane_bits,
+                                                                                         CcvStats *stats) {
+    return compute_ccv_native_topk(CsrGraph::fromMatrix(A), k, lane_bits, stats);
+}
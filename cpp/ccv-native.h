@@ -0,0 +1,27 @@
+#pragma once
+
+#include <vector>
+#include "gb_utils.h"
+#include "csr.h"
+#include "ccv.h"
+
+// Kernels process sources in batches of lane_bits (64, 128, 256 or 512) bits per vertex.
+// If lane_bits is 0, the smallest width covering the (component) size is chosen up to the widest SIMD register
+// of the build target.
+
+/// Closeness centrality values of the vertices which might be among the k most central ones.
+/// Traversal from a vertex stops once an upper bound of its value falls strictly below the k-th best exact value,
+/// such vertices are omitted from the result. Remaining values are identical to compute_ccv.
+void msbfs_closeness_native_topk(CsrGraph const &graph, uint64_t k,
+                                 std::vector<GrB_Index> &ccv_indices, std::vector<double> &ccv_values,
+                                 GrB_Index lane_bits = 0, CcvStats *stats = nullptr);
+
+std::tuple<GBxx_Object<GrB_Vector>, std::unique_ptr<GrB_Index[]>> compute_ccv_native_topk(CsrGraph const &graph,
+                                                                                         uint64_t k,
+                                                                                         GrB_Index lane_bits = 0,
+                                                                                         CcvStats *stats = nullptr);
+
+std::tuple<GBxx_Object<GrB_Vector>, std::unique_ptr<GrB_Index[]>> compute_ccv_native_topk(GrB_Matrix A,
+                                                                                         uint64_t k,
+                                                                                         GrB_Index lane_bits = 0,
+                                                                                         CcvStats *stats = nullptr);
@@ -1,28 +1,28 @@
 #include "ccv.h"
 #include "assert.h"
+#include <exception>
 
 inline __attribute__((always_inline))
-void create_diagonal_bit_matrix(GrB_Matrix D) {
-    GrB_Index n, nrows;
-    ok(GrB_Matrix_ncols(&n, D));
+void create_diagonal_bit_matrix(GrB_Matrix D, GrB_Index first_source, GrB_Index batch_sources) {
 #ifndef NDEBUG
+    GrB_Index nrows;
     ok(GrB_Matrix_nrows(&nrows, D));
-    assert(nrows == (n + 63) / 64);
+    assert(nrows == (batch_sources + 63) / 64);
 #endif
 
-//    I = 0, 1, ..., n
-//    J = 0, 0, ..., 0 [64], 1, 1, ..., 1 [64], ..., ceil(n/64)
-//    X = repeat {b100..., b010..., b001..., ..., b...001} until we have n elements
+//    I = 0, 1, ..., batch_sources
+//    J = 0, 0, ..., 0 [64], 1, 1, ..., 1 [64], ..., ceil(batch_sources/64)
+//    X = repeat {b100..., b010..., b001..., ..., b...001} until we have batch_sources elements
+//    (source k of the batch is vertex first_source + k)
+    GrB_Index n = batch_sources;
     std::unique_ptr<GrB_Index[]> I{new GrB_Index[n]}, J{new GrB_Index[n]};
     std::unique_ptr<uint64_t[]> X{new uint64_t[n]};
 
-    int nthreads = GlobalNThreads;
-    nthreads = std::min<size_t>(n / 4096, nthreads);
-    nthreads = std::max(nthreads, 1);
+    int nthreads = threads_for(n);
 #pragma omp parallel for num_threads(nthreads) schedule(static)
     for (GrB_Index k = 0; k < n; k++) {
         I[k] = k / 64;
-        J[k] = k;
+        J[k] = first_source + k;
         X[k] = 1L << (k % 64);
     }
     ok(GrB_Matrix_build_UINT64(D, I.get(), J.get(), X.get(), n, GrB_BOR_UINT64));
@@ -32,49 +32,51 @@ void fun_sum_popcount(void *z, const void *x) {
     *((uint64_t *) z) = __builtin_popcountll(*((uint64_t *) x));
 }
 
-// TODO: mapping comes from LAGraph (C code) and needs to be freed
-std::tuple<GBxx_Object<GrB_Vector>, std::unique_ptr<GrB_Index[]>> compute_ccv(GrB_Matrix A) {
+/// Operators shared by the batches of a traversal, only read by them.
+struct MsbfsOperators {
     // initializing unary operator for next_popcount
     GBxx_Object<GrB_UnaryOp> op_popcount = GB(GrB_UnaryOp_new, fun_sum_popcount, GrB_UINT64, GrB_UINT64);
-    GBxx_Object<GrB_Semiring> BOR_FIRST, BOR_SECOND;
-    BOR_FIRST = GB(GrB_Semiring_new, GxB_BOR_UINT64_MONOID, GrB_FIRST_UINT64);
-    BOR_SECOND = GB(GrB_Semiring_new, GxB_BOR_UINT64_MONOID, GrB_SECOND_UINT64);
+    GBxx_Object<GrB_Semiring> BOR_FIRST = GB(GrB_Semiring_new, GxB_BOR_UINT64_MONOID, GrB_FIRST_UINT64);
+    GBxx_Object<GxB_Scalar> allOnes = GB(GxB_Scalar_new, GrB_UINT64);
+
+    MsbfsOperators() {
+        ok(GxB_Scalar_setElement_UINT64(allOnes.get(), 0xFFFFFFFFFFFFFFFF));
+    }
+};
 
+/// MSBFS from sources first_source, ..., first_source + batch_sources - 1 of A.
+/// Since A is symmetric, sp and compsize of a vertex are the sums of its distances to the sources and the number
+/// of sources reaching it (including itself), i.e. its contribution of this batch.
+void msbfs_batch(GrB_Matrix A, MsbfsOperators const &ops, GrB_Index first_source, GrB_Index batch_sources,
+                 GrB_Vector sp, GrB_Vector compsize, CcvStats *stats) {
     GrB_Index n;
     ok(GrB_Matrix_nrows(&n, A));
-    {
-        GrB_Index ncols;
-        ok(GrB_Matrix_ncols(&ncols, A));
-        assert(n == ncols); // TODO replace with proper input check
-    }
 
-    const GrB_Index bit_matrix_ncols = (n + 63) / 64;
+    const GrB_Index bit_matrix_ncols = (batch_sources + 63) / 64;
 
     GBxx_Object<GrB_Matrix> Next = GB(GrB_Matrix_new, GrB_UINT64, bit_matrix_ncols, n);
     GBxx_Object<GrB_Matrix> Next_PopCount = GB(GrB_Matrix_new, GrB_UINT64, bit_matrix_ncols, n);
     GBxx_Object<GrB_Matrix> Seen_PopCount = GB(GrB_Matrix_new, GrB_UINT64, bit_matrix_ncols, n);
 
     GBxx_Object<GrB_Vector> next_popcount = GB(GrB_Vector_new, GrB_UINT64, n);
-    GBxx_Object<GrB_Vector> sp = GB(GrB_Vector_new, GrB_UINT64, n);
-    GBxx_Object<GrB_Vector> compsize = GB(GrB_Vector_new, GrB_UINT64, n);
-    GBxx_Object<GrB_Vector> ccv_result = GB(GrB_Vector_new, GrB_FP64, n);
 
     // initialize Next and Seen matrices: to compute closeness centrality, start off with a diagonal
-    create_diagonal_bit_matrix(Next.get());
+    create_diagonal_bit_matrix(Next.get(), first_source, batch_sources);
     GBxx_Object<GrB_Matrix> Seen = GB(GrB_Matrix_dup, Next.get());
     GBxx_Object<GrB_Matrix> AllSeen = GB(GrB_Matrix_new, GrB_BOOL, bit_matrix_ncols, n); // hack: only use pattern
 
-    GxB_Scalar allOnes;
-    ok(GxB_Scalar_new(&allOnes, GrB_UINT64));
-    ok(GxB_Scalar_setElement_UINT64(allOnes, 0xFFFFFFFFFFFFFFFF));
+    // Seen and Next hold UINT64 values and indices
+    GrB_Index const bytes_per_entry = 2 * sizeof(uint64_t);
+    GrB_Index levels = 0, peak_nvals = 0;
 
     // traversal
     for (GrB_Index level = 1; level < n; level++) {
+        check_deadline();
 //        printf("========================= Level %2ld =========================\n\n", level);
-        ok(GxB_Matrix_select(AllSeen.get(), NULL, NULL, GxB_EQ_THUNK, Seen.get(), allOnes, NULL));
+        ok(GxB_Matrix_select(AllSeen.get(), NULL, NULL, GxB_EQ_THUNK, Seen.get(), ops.allOnes.get(), NULL));
 
         // Next = A * Next
-        ok(GrB_mxm(Next.get(), AllSeen.get(), NULL, BOR_FIRST.get(), Next.get(), A, GrB_DESC_RSC));
+        ok(GrB_mxm(Next.get(), AllSeen.get(), NULL, ops.BOR_FIRST.get(), Next.get(), A, GrB_DESC_RSC));
 
         // Next = Next & ~Seen
         // We need to use eWiseAdd to see the union of value but mask with Next so that
@@ -113,22 +115,110 @@ std::tuple<GBxx_Object<GrB_Vector>, std::unique_ptr<GrB_Index[]>> compute_ccv(Gr
             break;
         }
         // next_popCount = reduce(apply(popcount, Next))
-        ok(GrB_Matrix_apply(Next_PopCount.get(), NULL, NULL, op_popcount.get(), Next.get(), NULL));
+        ok(GrB_Matrix_apply(Next_PopCount.get(), NULL, NULL, ops.op_popcount.get(), Next.get(), NULL));
         ok(GrB_Matrix_reduce_Monoid(next_popcount.get(), NULL, NULL, GxB_PLUS_UINT64_MONOID, Next_PopCount.get(),
                 GrB_DESC_T0));
 
         // Seen = Seen | Next
         ok(GrB_Matrix_eWiseAdd_BinaryOp(Seen.get(), NULL, NULL, GrB_BOR_UINT64, Seen.get(), Next.get(), NULL));
 
+        if (stats) {
+            GrB_Index seen_nvals;
+            ok(GrB_Matrix_nvals(&seen_nvals, Seen.get()));
+            levels = level;
+            peak_nvals = std::max(peak_nvals, seen_nvals + next_nvals);
+        }
+
         // sp += (next_popcount * level)
         //   next_popcount * level is expressed as next_popcount *= level_v
         ok(GrB_Vector_apply_BinaryOp1st_UINT64(next_popcount.get(), NULL, NULL, GrB_TIMES_UINT64, level, next_popcount.get(), NULL));
 
-        ok(GrB_Vector_eWiseAdd_BinaryOp(sp.get(), NULL, NULL, GrB_PLUS_UINT64, sp.get(), next_popcount.get(), NULL));
+        ok(GrB_Vector_eWiseAdd_BinaryOp(sp, NULL, NULL, GrB_PLUS_UINT64, sp, next_popcount.get(), NULL));
     }
     // compsize = reduce(Seen, row -> popcount(row))
-    ok(GrB_Matrix_apply(Seen_PopCount.get(), NULL, NULL, op_popcount.get(), Seen.get(), NULL));
-    ok(GrB_Matrix_reduce_Monoid(compsize.get(), NULL, NULL, GxB_PLUS_UINT64_MONOID, Seen_PopCount.get(), GrB_DESC_T0));
+    ok(GrB_Matrix_apply(Seen_PopCount.get(), NULL, NULL, ops.op_popcount.get(), Seen.get(), NULL));
+    ok(GrB_Matrix_reduce_Monoid(compsize, NULL, NULL, GxB_PLUS_UINT64_MONOID, Seen_PopCount.get(), GrB_DESC_T0));
+
+    if (stats)
+        *stats = CcvStats{levels, peak_nvals * bytes_per_entry};
+}
+
+// TODO: mapping comes from LAGraph (C code) and needs to be freed
+std::tuple<GBxx_Object<GrB_Vector>, std::unique_ptr<GrB_Index[]>> compute_ccv(GrB_Matrix A, GrB_Index batch_size,
+                                                                             CcvStats *stats) {
+    GrB_Index n;
+    ok(GrB_Matrix_nrows(&n, A));
+    {
+        GrB_Index ncols;
+        ok(GrB_Matrix_ncols(&ncols, A));
+        assert(n == ncols); // TODO replace with proper input check
+    }
+
+    MsbfsOperators ops;
+    GBxx_Object<GrB_Vector> sp = GB(GrB_Vector_new, GrB_UINT64, n);
+    GBxx_Object<GrB_Vector> compsize = GB(GrB_Vector_new, GrB_UINT64, n);
+    GBxx_Object<GrB_Vector> ccv_result = GB(GrB_Vector_new, GrB_FP64, n);
+
+    // whole words of sources per batch
+    if (batch_size == 0 || batch_size >= n)
+        batch_size = n;
+    else
+        batch_size = (batch_size + 63) / 64 * 64;
+    GrB_Index const batch_count = n == 0 ? 0 : (n + batch_size - 1) / batch_size;
+
+    if (batch_count <= 1) {
+        // a single batch: GraphBLAS operations use every thread
+        msbfs_batch(A, ops, 0, n, sp.get(), compsize.get(), stats);
+    } else {
+        // batches run in parallel, the GraphBLAS operations of a batch are nested and therefore single-threaded
+        // A is read concurrently, so finish its pending operations first
+        GrB_Matrix A_ptr = A;
+        ok(GrB_Matrix_wait(&A_ptr));
+
+        int nthreads = std::min<GrB_Index>(std::max(GlobalNThreads, 1), batch_count);
+        CcvStats batches_stats;
+        std::exception_ptr batch_error;
+        auto deadline = QueryDeadline;
+#pragma omp parallel for num_threads(nthreads) schedule(dynamic)
+        for (GrB_Index batch = 0; batch < batch_count; ++batch) {
+            try {
+                DeadlineScope deadline_scope{deadline};
+                ThreadsScope threads{1};
+                GrB_Index first_source = batch * batch_size;
+                GrB_Index batch_sources = std::min(batch_size, n - first_source);
+
+                GBxx_Object<GrB_Vector> batch_sp = GB(GrB_Vector_new, GrB_UINT64, n);
+                GBxx_Object<GrB_Vector> batch_compsize = GB(GrB_Vector_new, GrB_UINT64, n);
+                CcvStats batch_stats;
+                msbfs_batch(A, ops, first_source, batch_sources, batch_sp.get(), batch_compsize.get(),
+                            stats ? &batch_stats : nullptr);
+
+#pragma omp critical(ccv_batch)
+                try {
+                    ok(GrB_Vector_eWiseAdd_BinaryOp(sp.get(), NULL, NULL, GrB_PLUS_UINT64, sp.get(), batch_sp.get(),
+                                                    NULL));
+                    ok(GrB_Vector_eWiseAdd_BinaryOp(compsize.get(), NULL, NULL, GrB_PLUS_UINT64, compsize.get(),
+                                                    batch_compsize.get(), NULL));
+                    batches_stats.levels = std::max(batches_stats.levels, batch_stats.levels);
+                    batches_stats.peakBytes = std::max(batches_stats.peakBytes, batch_stats.peakBytes);
+                } catch (...) {
+                    if (!batch_error)
+                        batch_error = std::current_exception();
+                }
+            } catch (...) {
+                // exceptions must not leave the parallel region
+#pragma omp critical(ccv_batch)
+                if (!batch_error)
+                    batch_error = std::current_exception();
+            }
+        }
+        if (batch_error)
+            std::rethrow_exception(batch_error);
+
+        // up to nthreads batches are traversed at the same time
+        if (stats)
+            *stats = CcvStats{batches_stats.levels, batches_stats.peakBytes * nthreads};
+    }
 
     // compute the closeness centrality value:
     //
@@ -1,5 +1,38 @@
 #pragma once
 
+#include <vector>
 #include "gb_utils.h"
 
-std::tuple<GBxx_Object<GrB_Vector>, std::unique_ptr<GrB_Index[]>> compute_ccv(GrB_Matrix A);
+/// Statistics of a closeness centrality computation.
+struct CcvStats {
+    /// deepest BFS level
+    uint64_t levels = 0;
+    /// estimated peak bytes of the traversal state
+    uint64_t peakBytes = 0;
+    /// approximate kernel: sampled sources
+    uint64_t samples = 0;
+    /// approximate kernel: candidates whose value was computed exactly
+    uint64_t verified = 0;
+};
+
+/// (C(p)-1)^2 / ((n-1)*s(p)) evaluated exactly like compute_ccv, so bounds and values of the kernels are comparable
+inline double closeness_value(GrB_Index n, uint64_t compsize, uint64_t sp) {
+    uint64_t numerator = (compsize - 1) * (compsize - 1);
+    uint64_t denominator = (n - 1) * sp;
+    return static_cast<double>(numerator) / static_cast<double>(denominator);
+}
+
+/// Closeness centrality vector of n vertices from the values of some of them.
+inline GBxx_Object<GrB_Vector> build_ccv_vector(GrB_Index n, std::vector<GrB_Index> const &ccv_indices,
+                                                std::vector<double> const &ccv_values) {
+    GBxx_Object<GrB_Vector> ccv_result = GB(GrB_Vector_new, GrB_FP64, n);
+    ok(GrB_Vector_build_FP64(ccv_result.get(), ccv_indices.data(), ccv_values.data(), ccv_indices.size(),
+                             GrB_FIRST_FP64));
+    return ccv_result;
+}
+
+/// Closeness centrality values of the vertices of A by bit-packed GraphBLAS MSBFS.
+/// Sources are traversed in parallel batches of batch_size (rounded up to multiples of 64, 0: all at once),
+/// so the traversal state grows with batch_size * n instead of n^2.
+std::tuple<GBxx_Object<GrB_Vector>, std::unique_ptr<GrB_Index[]>> compute_ccv(GrB_Matrix A, GrB_Index batch_size = 0,
+                                                                             CcvStats *stats = nullptr);
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <vector>
+#include <cassert>
+#include <limits>
+#include <algorithm>
+#include "gb_utils.h"
+
+/// Adjacency lists of a square matrix in compressed sparse row (CSR) format for native kernels.
+struct CsrGraph {
+    /// vertex indices are 32-bit to halve the footprint of the adjacency lists
+    using Vertex = uint32_t;
+
+    /// neighbors of vertex v are neighbors[offsets[v]..offsets[v+1])
+    std::vector<GrB_Index> offsets{0};
+    std::vector<Vertex> neighbors;
+
+    GrB_Index size() const {
+        return offsets.size() - 1;
+    }
+
+    Vertex const *neighborsBegin(GrB_Index vertex) const {
+        return neighbors.data() + offsets[vertex];
+    }
+
+    Vertex const *neighborsEnd(GrB_Index vertex) const {
+        return neighbors.data() + offsets[vertex + 1];
+    }
+
+    /// Subgraph induced by vertices, renumbered by their positions in vertices.
+    /// Sorted vertices keep the adjacency lists sorted.
+    CsrGraph inducedSubgraph(std::vector<GrB_Index> const &vertices) const {
+        assert(std::is_sorted(vertices.begin(), vertices.end()));
+        GrB_Index const n = vertices.size();
+        Vertex *relabel = relabelBuffer(size());
+
+        int nthreads = threads_for(n);
+
+        CsrGraph subgraph;
+        subgraph.offsets.assign(n + 1, 0);
+#pragma omp parallel num_threads(nthreads)
+        {
+#pragma omp for schedule(static)
+            for (GrB_Index i = 0; i < n; ++i)
+                relabel[vertices[i]] = i;
+
+            // degrees within the subgraph
+#pragma omp for schedule(dynamic, 1024)
+            for (GrB_Index i = 0; i < n; ++i)
+                subgraph.offsets[i + 1] = std::count_if(neighborsBegin(vertices[i]), neighborsEnd(vertices[i]),
+                                                        [&](Vertex v) { return relabel[v] != NotInSubgraph; });
+        }
+        for (GrB_Index i = 0; i < n; ++i)
+            subgraph.offsets[i + 1] += subgraph.offsets[i];
+
+        subgraph.neighbors.resize(subgraph.offsets.back());
+#pragma omp parallel num_threads(nthreads)
+        {
+#pragma omp for schedule(dynamic, 1024)
+            for (GrB_Index i = 0; i < n; ++i) {
+                Vertex *out = subgraph.neighbors.data() + subgraph.offsets[i];
+                for (auto it = neighborsBegin(vertices[i]), end = neighborsEnd(vertices[i]); it != end; ++it)
+                    if (relabel[*it] != NotInSubgraph)
+                        *out++ = relabel[*it];
+            }
+
+            // leave the buffer clean for the next extraction
+#pragma omp for schedule(static)
+            for (GrB_Index i = 0; i < n; ++i)
+                relabel[vertices[i]] = NotInSubgraph;
+        }
+
+        return subgraph;
+    }
+
+    /// Vertices of each connected component, in ascending order.
+    std::vector<std::vector<GrB_Index>> connectedComponents() const {
+        GrB_Index const n = size();
+        std::vector<bool> visited(n, false);
+        std::vector<std::vector<GrB_Index>> components;
+
+        for (GrB_Index root = 0; root < n; ++root) {
+            if (visited[root])
+                continue;
+
+            std::vector<GrB_Index> component{root};
+            visited[root] = true;
+            for (size_t i = 0; i < component.size(); ++i)
+                for (auto it = neighborsBegin(component[i]), end = neighborsEnd(component[i]); it != end; ++it)
+                    if (!visited[*it]) {
+                        visited[*it] = true;
+                        component.push_back(*it);
+                    }
+
+            std::sort(component.begin(), component.end());
+            components.push_back(std::move(component));
+        }
+        return components;
+    }
+
+    /// Boolean adjacency matrix for GraphBLAS algorithms.
+    GBxx_Object<GrB_Matrix> toMatrix() const {
+        GrB_Index const n = size(), nvals = neighbors.size();
+        std::vector<GrB_Index> rows(nvals), cols(neighbors.begin(), neighbors.end());
+
+        int nthreads = threads_for(n);
+#pragma omp parallel for num_threads(nthreads) schedule(dynamic, 1024)
+        for (GrB_Index v = 0; v < n; ++v)
+            std::fill(rows.begin() + offsets[v], rows.begin() + offsets[v + 1], v);
+
+        GBxx_Object<GrB_Matrix> A = GB(GrB_Matrix_new, GrB_BOOL, n, n);
+        ok(GrB_Matrix_build_BOOL(A.get(), rows.data(), cols.data(), array_of_true(nvals).get(), nvals, GrB_LOR));
+        return A;
+    }
+
+    static CsrGraph fromMatrix(GrB_Matrix A) {
+        GrB_Index n, nvals;
+        ok(GrB_Matrix_nrows(&n, A));
+        ok(GrB_Matrix_nvals(&nvals, A));
+        if (n > std::numeric_limits<Vertex>::max())
+            throw std::runtime_error{"Too many vertices for CSR: " + std::to_string(n)};
+
+        std::vector<GrB_Index> rows(nvals), cols(nvals);
+        {
+            GrB_Index nvals_out = nvals;
+            ok(GrB_Matrix_extractTuples_BOOL(rows.data(), cols.data(), GrB_NULL, &nvals_out, A));
+            assert(nvals == nvals_out);
+        }
+
+        // counting sort by rows, tuples are not guaranteed to be ordered
+        CsrGraph graph;
+        graph.offsets.assign(n + 1, 0);
+        for (GrB_Index row : rows)
+            ++graph.offsets[row + 1];
+        for (GrB_Index v = 0; v < n; ++v)
+            graph.offsets[v + 1] += graph.offsets[v];
+
+        graph.neighbors.resize(nvals);
+        std::vector<GrB_Index> positions(graph.offsets.begin(), graph.offsets.end() - 1);
+        for (GrB_Index i = 0; i < nvals; ++i)
+            graph.neighbors[positions[rows[i]]++] = cols[i];
+
+        return graph;
+    }
+
+private:
+    static constexpr Vertex NotInSubgraph = std::numeric_limits<Vertex>::max();
+
+    /// Old to new vertex indices of inducedSubgraph, NotInSubgraph outside of an extraction.
+    /// Kept per thread, so extractions run in parallel without clearing a dense array each time.
+    static Vertex *relabelBuffer(GrB_Index n) {
+        thread_local std::vector<Vertex> relabel;
+        if (relabel.size() < n)
+            relabel.resize(n, NotInSubgraph);
+        return relabel.data();
+    }
+};
@@ -0,0 +1,165 @@
+#pragma once
+
+// Profile of the GraphBLAS calls made through ok() and GB(), compiled only with the GB_PROFILE CMake option.
+// gb_utils.h turns ok() and GB() into macros recording their call site (file:line): the number of calls,
+// the total and maximum time, and for objects created by GB() their entries. Each thread records into its own table,
+// the tables are merged and printed to stderr at exit, ranked by total time.
+// Included by gb_utils.h after GraphBLAS.h.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <vector>
+
+/// Location of an ok() or GB() macro, call holds its arguments as written.
+struct GbCallSite {
+    char const *file;
+    int line;
+    char const *call;
+};
+
+struct GbCallStats {
+    char const *call = "";
+    uint64_t count = 0;
+    std::chrono::nanoseconds totalTime{0}, maxTime{0};
+    /// objects created by GB() whose entries are counted, and their total entries
+    uint64_t outputs = 0, outputNvals = 0;
+
+    void add(GbCallStats const &other) {
+        count += other.count;
+        totalTime += other.totalTime;
+        maxTime = std::max(maxTime, other.maxTime);
+        outputs += other.outputs;
+        outputNvals += other.outputNvals;
+    }
+};
+
+/// Statistics of a thread by call site, kept after the thread exits.
+struct GbProfileTable {
+    std::mutex mutex;
+    std::map<std::tuple<char const *, int>, GbCallStats> stats;
+};
+
+inline std::mutex GbProfileTablesMutex;
+inline std::vector<std::shared_ptr<GbProfileTable>> GbProfileTables;
+
+inline void print_gb_profile();
+
+inline GbProfileTable &gb_profile_table() {
+    thread_local std::shared_ptr<GbProfileTable> table = []() {
+        std::lock_guard<std::mutex> lock{GbProfileTablesMutex};
+        if (GbProfileTables.empty())
+            std::atexit(print_gb_profile);
+        auto new_table = std::make_shared<GbProfileTable>();
+        GbProfileTables.push_back(new_table);
+        return new_table;
+    }();
+    return *table;
+}
+
+/// Records a call from its construction to its destruction.
+class GbProfileScope {
+    GbCallSite site;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::optional<std::chrono::nanoseconds> time;
+    std::optional<GrB_Index> outputNvals;
+
+public:
+    explicit GbProfileScope(GbCallSite site) : site(site) {}
+
+    GbProfileScope(GbProfileScope const &) = delete;
+
+    GbProfileScope &operator=(GbProfileScope const &) = delete;
+
+    /// Ends the call before the scope, e.g. to inspect its output.
+    void stop() {
+        time = std::chrono::steady_clock::now() - start;
+    }
+
+    /// \param nvals entries of the object created by the call
+    void setOutputNvals(GrB_Index nvals) {
+        outputNvals = nvals;
+    }
+
+    ~GbProfileScope() {
+        if (!time)
+            stop();
+        GbProfileTable &table = gb_profile_table();
+        std::lock_guard<std::mutex> lock{table.mutex};
+        GbCallStats &stats = table.stats[std::make_tuple(site.file, site.line)];
+        stats.call = site.call;
+        ++stats.count;
+        stats.totalTime += *time;
+        stats.maxTime = std::max(stats.maxTime, *time);
+        if (outputNvals) {
+            ++stats.outputs;
+            stats.outputNvals += *outputNvals;
+        }
+    }
+};
+
+/// Name of the called function: the call up to its first parenthesis or comma.
+inline std::string gb_function_name(char const *call) {
+    std::string name{call};
+    return name.substr(0, name.find_first_of("(,"));
+}
+
+/// Prints the call sites of every thread ranked by total time.
+inline void print_gb_profile() {
+    using namespace std::chrono;
+
+    // the same file might have a different name pointer in each translation unit
+    std::map<std::tuple<std::string, int>, GbCallStats> merged;
+    {
+        std::lock_guard<std::mutex> tables_lock{GbProfileTablesMutex};
+        for (auto const &table : GbProfileTables) {
+            std::lock_guard<std::mutex> lock{table->mutex};
+            for (auto const &[site, stats] : table->stats) {
+                GbCallStats &merged_stats = merged[std::make_tuple(std::string{std::get<0>(site)},
+                                                                   std::get<1>(site))];
+                merged_stats.call = stats.call;
+                merged_stats.add(stats);
+            }
+        }
+    }
+
+    std::vector<std::pair<std::string, GbCallStats>> ranked;
+    nanoseconds total_time{0};
+    for (auto const &[site, stats] : merged) {
+        ranked.emplace_back(std::get<0>(site) + ':' + std::to_string(std::get<1>(site)), stats);
+        total_time += stats.totalTime;
+    }
+    std::sort(ranked.begin(), ranked.end(), [](auto const &lhs, auto const &rhs) {
+        return lhs.second.totalTime > rhs.second.totalTime;
+    });
+
+    std::cerr << "GraphBLAS calls by total time: " << ranked.size() << " call sites, "
+              << duration<double, std::milli>(total_time).count() << " ms\n"
+              << std::setw(12) << "total ms" << std::setw(8) << "share" << std::setw(10) << "calls"
+              << std::setw(12) << "mean us" << std::setw(12) << "max us" << std::setw(14) << "mean nvals"
+              << "  site  function\n";
+    for (auto const &[site, stats] : ranked) {
+        std::cerr << std::fixed << std::setprecision(3)
+                  << std::setw(12) << duration<double, std::milli>(stats.totalTime).count()
+                  << std::setprecision(1)
+                  << std::setw(7) << (total_time.count() == 0 ? 0.0 : 100.0 * stats.totalTime / total_time) << '%'
+                  << std::setw(10) << stats.count
+                  << std::setw(12) << duration<double, std::micro>(stats.totalTime).count() / stats.count
+                  << std::setw(12) << duration<double, std::micro>(stats.maxTime).count();
+        if (stats.outputs != 0)
+            std::cerr << std::setw(14) << stats.outputNvals / stats.outputs;
+        else
+            std::cerr << std::setw(14) << '-';
+        std::cerr << "  " << site << "  " << gb_function_name(stats.call) << '\n';
+    }
+    std::cerr << std::defaultfloat << std::flush;
+}
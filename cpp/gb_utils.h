@@ -11,6 +11,10 @@ extern "C" {
 
 #include "utils.h"
 
+#ifdef GB_PROFILE
+#include "gb_profile.h"
+#endif
+
 //------------------------------------------------------------------------------
 // ok: call a GraphBLAS method and check the result
 //------------------------------------------------------------------------------
@@ -29,13 +33,16 @@ GrB_Info ok(GrB_Info info, bool no_value_is_error = true) {
     }
 }
 
+#ifdef GB_PROFILE
+// the call site is recorded until the end of the full expression, which contains the call as the argument of ok
+#define ok(...) (GbProfileScope{GbCallSite{__FILE__, __LINE__, #__VA_ARGS__}}, ok(__VA_ARGS__))
+#endif
+
 inline __attribute__((always_inline))
 std::unique_ptr<bool[]> array_of_true(size_t n) {
     std::unique_ptr<bool[]> array{new bool[n]};
 
-    int nthreads = GlobalNThreads;
-    nthreads = std::min<size_t>(n / 4096, nthreads);
-    nthreads = std::max(nthreads, 1);
+    int nthreads = threads_for(n);
 #pragma omp parallel for num_threads(nthreads) schedule(static)
     for (size_t i = 0; i < n; ++i) {
         array[i] = true;
@@ -48,9 +55,7 @@ inline __attribute__((always_inline))
 std::unique_ptr<GrB_Index[]> array_of_indices(size_t n) {
     std::unique_ptr<GrB_Index[]> array{new GrB_Index[n]};
 
-    int nthreads = GlobalNThreads;
-    nthreads = std::min<size_t>(n / 4096, nthreads);
-    nthreads = std::max(nthreads, 1);
+    int nthreads = threads_for(n);
 #pragma omp parallel for num_threads(nthreads) schedule(static)
     for (size_t i = 0; i < n; ++i) {
         array[i] = i;
@@ -194,5 +199,30 @@ GBxx_Object<Type> GB(GrB_Info (&func)(Type *, Args...), ArgsIn &&... args) {
     return {gb_instance, {}};
 }
 
+#ifdef GB_PROFILE
+/// GB() recording its call site and the entries of the created object, which has no pending work to finish.
+template<typename Type, typename ...ArgsIn, typename ...Args>
+GBxx_Object<Type> GB(GbCallSite site, GrB_Info (&func)(Type *, Args...), ArgsIn &&... args) {
+    GbProfileScope scope{site};
+    Type gb_instance = nullptr;
+    // parenthesized: not recorded as a call site of ok
+    (ok)(func(&gb_instance, std::forward<ArgsIn>(args)...));
+    scope.stop();
+
+    GrB_Index nvals;
+    if constexpr (std::is_same_v<Type, GrB_Matrix>) {
+        if (GrB_Matrix_nvals(&nvals, gb_instance) == GrB_SUCCESS)
+            scope.setOutputNvals(nvals);
+    } else if constexpr (std::is_same_v<Type, GrB_Vector>) {
+        if (GrB_Vector_nvals(&nvals, gb_instance) == GrB_SUCCESS)
+            scope.setOutputNvals(nvals);
+    }
+
+    return {gb_instance, {}};
+}
+
+#define GB(...) GB(GbCallSite{__FILE__, __LINE__, #__VA_ARGS__}, __VA_ARGS__)
+#endif
+
 template<typename Z, typename X>
 using GBxx_unary_function = void (*)(Z *, const X *);
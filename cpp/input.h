@@ -1,7 +1,14 @@
 #pragma once
 
 #include "load.h"
-
+#include "query-caches.h"
+#include "csr.h"
+
+#include <array>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 class Places : public VertexCollection<2> {
@@ -140,12 +147,15 @@ struct PersonIsLocatedInCityTranEdgeCollection : public EdgeCollection {
         src = &places;
         edgeNumber = persons.size();
 
+        TRACE_PHASES();
+        TRACE_PHASE("relabel", "person isLocatedIn city");
         // convert city IDs to indices in persons
         for (int person_index = 0; person_index < persons.size(); ++person_index) {
             GrB_Index &city_index = persons.cityIndices[person_index];
             city_index = places.idToIndex(city_index);
         }
 
+        TRACE_PHASE("build", "person isLocatedIn city");
         matrix = GB(GrB_Matrix_new, GrB_BOOL, src->size(), trg->size());
         ok(GrB_Matrix_build_BOOL(matrix.get(),
                                  persons.cityIndices.data(), array_of_indices(edgeNumber).get(),
@@ -213,12 +223,15 @@ struct HasCreatorEdgeCollection : public EdgeCollection {
         trg = &persons;
         edgeNumber = comments.size();
 
+        TRACE_PHASES();
+        TRACE_PHASE("relabel", "comment hasCreator person");
         // convert person IDs to indices in comments
         for (int comment_index = 0; comment_index < comments.size(); ++comment_index) {
             GrB_Index &person_index = comments.creatorPersonIndices[comment_index];
             person_index = persons.idToIndex(person_index);
         }
 
+        TRACE_PHASE("build", "comment hasCreator person");
         matrix = GB(GrB_Matrix_new, GrB_BOOL, src->size(), trg->size());
         ok(GrB_Matrix_build_BOOL(matrix.get(),
                                  array_of_indices(edgeNumber).get(), comments.creatorPersonIndices.data(),
@@ -286,6 +299,8 @@ struct OrganizationIsLocatedInPlaceTranEdgeCollection : public EdgeCollection {
         src = &places;
         edgeNumber = organizations.size();
 
+        TRACE_PHASES();
+        TRACE_PHASE("relabel", "organisation isLocatedIn place");
         // convert place IDs to indices in organizations
         for (int organization_index = 0; organization_index < organizations.size(); ++organization_index) {
             GrB_Index &place_index = organizations.placeIndices[organization_index];
@@ -300,6 +315,7 @@ struct OrganizationIsLocatedInPlaceTranEdgeCollection : public EdgeCollection {
             organizations.types[organization_index] = type;
         }
 
+        TRACE_PHASE("build", "organisation isLocatedIn place");
         matrix = GB(GrB_Matrix_new, GrB_BOOL, src->size(), trg->size());
         ok(GrB_Matrix_build_BOOL(matrix.get(),
                                  organizations.placeIndices.data(), array_of_indices(edgeNumber).get(),
@@ -308,6 +324,90 @@ struct OrganizationIsLocatedInPlaceTranEdgeCollection : public EdgeCollection {
     }
 };
 
+/// Persons relevant to each place: persons located in or studying at a university in its cities,
+/// and persons working at a company in its countries.
+/// Computed once at load time by a bottom-up pass over the place hierarchy (city -> country -> continent).
+struct PlaceRelevantPersonsIndex {
+    /// relevant persons of place p are stored in personIndices[offsets[p], offsets[p + 1]), sorted by index
+    std::vector<GrB_Index> offsets;
+    std::vector<GrB_Index> personIndices;
+
+    void build(Places const &places, Persons const &persons, Organizations const &organizations,
+               EdgeCollection const &isPartOfTran, EdgeCollection const &workAtTran,
+               EdgeCollection const &studyAtTran) {
+        std::vector<std::vector<GrB_Index>> place_persons(places.size());
+
+        // persons located in cities
+        for (GrB_Index person_index = 0; person_index < persons.size(); ++person_index)
+            place_persons[persons.cityIndices[person_index]].push_back(person_index);
+
+        // persons working at companies (located in countries) or studying at universities (located in cities)
+        auto add_organization_members = [&](EdgeCollection const &edge, Places::Type place_type) {
+            std::vector<GrB_Index> organization_indices(edge.edgeNumber), person_indices(edge.edgeNumber);
+            GrB_Index nvals = edge.edgeNumber;
+            ok(GrB_Matrix_extractTuples_BOOL(organization_indices.data(), person_indices.data(), GrB_NULL, &nvals,
+                                             edge.matrix.get()));
+
+            for (GrB_Index i = 0; i < nvals; ++i) {
+                GrB_Index place_index = organizations.placeIndices[organization_indices[i]];
+                if (places.types[place_index] == place_type)
+                    place_persons[place_index].push_back(person_indices[i]);
+            }
+        };
+        add_organization_members(workAtTran, Places::Country);
+        add_organization_members(studyAtTran, Places::City);
+
+        // parts of places
+        std::vector<std::vector<GrB_Index>> place_parts(places.size());
+        {
+            std::vector<GrB_Index> parent_indices(isPartOfTran.edgeNumber), part_indices(isPartOfTran.edgeNumber);
+            GrB_Index nvals = isPartOfTran.edgeNumber;
+            ok(GrB_Matrix_extractTuples_BOOL(parent_indices.data(), part_indices.data(), GrB_NULL, &nvals,
+                                             isPartOfTran.matrix.get()));
+            for (GrB_Index i = 0; i < nvals; ++i)
+                place_parts[parent_indices[i]].push_back(part_indices[i]);
+        }
+
+        // bottom-up: parts are always one level deeper, so their lists are complete when a level is processed
+        int nthreads = std::max(GlobalNThreads, 1);
+        for (Places::Type level : {Places::City, Places::Country, Places::Continent}) {
+#pragma omp parallel for num_threads(nthreads) schedule(dynamic)
+            for (GrB_Index place_index = 0; place_index < places.size(); ++place_index) {
+                if (places.types[place_index] != level)
+                    continue;
+
+                std::vector<GrB_Index> &relevant_persons = place_persons[place_index];
+                for (GrB_Index part_index : place_parts[place_index]) {
+                    assert(places.types[part_index] != level);
+                    relevant_persons.insert(relevant_persons.end(),
+                                            place_persons[part_index].begin(), place_persons[part_index].end());
+                }
+
+                std::sort(relevant_persons.begin(), relevant_persons.end());
+                relevant_persons.erase(std::unique(relevant_persons.begin(), relevant_persons.end()),
+                                       relevant_persons.end());
+            }
+        }
+
+        offsets.assign(places.size() + 1, 0);
+        for (GrB_Index place_index = 0; place_index < places.size(); ++place_index)
+            offsets[place_index + 1] = offsets[place_index] + place_persons[place_index].size();
+
+        personIndices.resize(offsets.back());
+        for (GrB_Index place_index = 0; place_index < places.size(); ++place_index)
+            std::copy(place_persons[place_index].begin(), place_persons[place_index].end(),
+                      personIndices.begin() + offsets[place_index]);
+    }
+
+    GrB_Index size(GrB_Index place_index) const {
+        return offsets[place_index + 1] - offsets[place_index];
+    }
+
+    GrB_Index const *personsOf(GrB_Index place_index) const {
+        return personIndices.data() + offsets[place_index];
+    }
+};
+
 struct QueryInput : public BaseQueryInput {
     Places places;
     Tags tags;
@@ -329,7 +429,15 @@ struct QueryInput : public BaseQueryInput {
     EdgeCollection workAtTran;
     EdgeCollection studyAtTran;
 
-    explicit QueryInput(const BenchmarkParameters &parameters) :
+    PlaceRelevantPersonsIndex placeRelevantPersons;
+    /// adjacency lists of knows for the induced subgraphs of Query2 and Query4
+    CsrGraph knowsGraph;
+
+    /// intermediate results shared among queries, therefore modifiable
+    mutable QueryCaches caches;
+
+    /// \param pipelined collections are loaded later by loadInBackground, otherwise those of parameters.Query
+    explicit QueryInput(const BenchmarkParameters &parameters, bool pipelined = false) :
             places{parameters.CsvPath + "place.csv"},
             tags{parameters.CsvPath + "tag.csv"},
             forums{parameters.CsvPath + "forum.csv"},
@@ -348,38 +456,136 @@ struct QueryInput : public BaseQueryInput {
             organizationIsLocatedInPlaceTran{organizations, places},
             isPartOfTran{parameters.CsvPath + "place_isPartOf_place.csv", true},
             workAtTran{parameters.CsvPath + "person_workAt_organisation.csv", true},
-            studyAtTran{parameters.CsvPath + "person_studyAt_organisation.csv", true} {
-        switch (parameters.Query) {
+            studyAtTran{parameters.CsvPath + "person_studyAt_organisation.csv", true},
+            caches{parameters} {
+        if (!pipelined) {
+            loadCollectionsOf(parameters.Query);
+            markLoaded(0);
+        }
+    }
+
+    QueryInput(QueryInput const &) = delete;
+
+    QueryInput &operator=(QueryInput const &) = delete;
+
+    ~QueryInput() {
+        if (loader.joinable())
+            loader.join();
+    }
+
+    /// Loads the collections on a background thread: those of query if it is 1-4, otherwise the collections
+    /// of every query in stages, cheapest first (4, 2, 3 and 1). Reports the time of each stage to stderr.
+    void loadInBackground(int query) {
+        loader = std::thread([this, query]() {
+            using namespace std::chrono;
+            auto start = high_resolution_clock::now();
+            try {
+                std::vector<int> stages{4, 2, 3, 1};
+                if (query >= 1 && query <= 4)
+                    stages = {query};
+
+                for (int stage : stages) {
+                    loadCollectionsOf(stage);
+                    markLoaded(stage);
+                    std::cerr << "Loaded collections of q" << stage << " after "
+                              << round<microseconds>(high_resolution_clock::now() - start).count() << " us"
+                              << std::endl;
+                }
+                markLoaded(0);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock{loadMutex};
+                loadError = std::current_exception();
+                loaded.notify_all();
+            }
+        });
+    }
+
+    /// Blocks until the collections of query are loaded (0: until loading has finished).
+    void waitForCollectionsOf(int query) const {
+        std::unique_lock<std::mutex> lock{loadMutex};
+        loaded.wait(lock, [&]() { return loadedQueries[query] || loadError; });
+        if (!loadedQueries[query])
+            std::rethrow_exception(loadError);
+    }
+
+private:
+    mutable std::mutex loadMutex;
+    mutable std::condition_variable loaded;
+    /// by query ID, 0: loading has finished
+    std::array<bool, 5> loadedQueries{};
+    std::exception_ptr loadError;
+    std::thread loader;
+
+    /// \param query 0: loading has finished, nothing more is going to be loaded for any query
+    void markLoaded(int query) {
+        std::lock_guard<std::mutex> lock{loadMutex};
+        if (query == 0)
+            loadedQueries.fill(true);
+        else
+            loadedQueries[query] = true;
+        loaded.notify_all();
+    }
+
+    template<typename Collection>
+    static bool contains(std::vector<std::reference_wrapper<Collection>> const &collections, Collection const &item) {
+        return std::any_of(collections.begin(), collections.end(),
+                           [&](Collection const &collection) { return &collection == &item; });
+    }
+
+    /// Loads the collections of query (every collection for other values) which are not loaded yet.
+    void loadCollectionsOf(int query) {
+        TRACE_SCOPE("load", query >= 1 && query <= 4 ? "q" + std::to_string(query) : "all");
+        std::vector<std::reference_wrapper<BaseVertexCollection>> vertex_collections;
+        std::vector<std::reference_wrapper<EdgeCollection>> edge_collections;
+        switch (query) {
             case 1:
-                vertexCollections = {comments, persons};
-                edgeCollections = {knows, hasCreator, replyOf};
+                vertex_collections = {comments, persons};
+                edge_collections = {knows, hasCreator, replyOf};
                 break;
             case 2:
-                vertexCollections = {tags, personsWithBirthdays};
-                edgeCollections = {knows, hasInterestTran};
+                vertex_collections = {tags, personsWithBirthdays};
+                edge_collections = {knows, hasInterestTran};
                 break;
             case 3:
-                vertexCollections = {places, tags, persons, organizations};
-                edgeCollections = {knows, hasInterestTran, personIsLocatedInCityTran,
-                                   organizationIsLocatedInPlaceTran, isPartOfTran, workAtTran, studyAtTran};
+                vertex_collections = {places, tags, persons, organizations};
+                edge_collections = {knows, hasInterestTran, personIsLocatedInCityTran,
+                                    organizationIsLocatedInPlaceTran, isPartOfTran, workAtTran, studyAtTran};
                 break;
             case 4:
-                vertexCollections = {tags, forums, persons};
-                edgeCollections = {knows, hasTag, hasMember};
+                vertex_collections = {tags, forums, persons};
+                edge_collections = {knows, hasTag, hasMember};
                 break;
             default:
-                vertexCollections = {places, tags, forums, persons, personsWithBirthdays, comments, organizations};
-                edgeCollections = {knows, hasInterestTran, hasCreator, replyOf, hasTag, hasMember,
-                                   personIsLocatedInCityTran, organizationIsLocatedInPlaceTran,
-                                   isPartOfTran, workAtTran, studyAtTran};
+                vertex_collections = {places, tags, forums, persons, personsWithBirthdays, comments, organizations};
+                edge_collections = {knows, hasInterestTran, hasCreator, replyOf, hasTag, hasMember,
+                                    personIsLocatedInCityTran, organizationIsLocatedInPlaceTran,
+                                    isPartOfTran, workAtTran, studyAtTran};
                 break;
         }
 
-        for (auto const &collection : vertexCollections) {
+        for (auto const &collection : vertex_collections) {
+            if (contains(vertexCollections, collection.get()))
+                continue;
             collection.get().importFile();
+            vertexCollections.push_back(collection);
         }
-        for (auto const &collection : edgeCollections) {
+        for (auto const &collection : edge_collections) {
+            if (contains(edgeCollections, collection.get()))
+                continue;
             collection.get().importFile(vertexCollections);
+            edgeCollections.push_back(collection);
+        }
+
+        // the index is needed by Query3, which is the only user of place hierarchy
+        if (contains(edge_collections, isPartOfTran) && placeRelevantPersons.offsets.empty()) {
+            TRACE_SCOPE("build", "place relevant persons");
+            placeRelevantPersons.build(places, persons, organizations, isPartOfTran, workAtTran, studyAtTran);
+        }
+
+        // only Query2 and Query4 extract subgraphs of knows
+        if (query != 1 && query != 3 && knowsGraph.size() == 0) {
+            TRACE_SCOPE("build", "knows CSR");
+            knowsGraph = CsrGraph::fromMatrix(knows.matrix.get());
         }
     }
 };
@@ -3,6 +3,7 @@
 #include "utils.h"
 #include "csv.h"
 #include "gb_utils.h"
+#include "trace.h"
 #include <fstream>
 #include <ctime>
 #include <memory>
@@ -96,6 +97,8 @@ public:
     virtual const char *getIdFieldPrefix() const { return "id:ID("; }
 
     void importFile() override {
+        TRACE_PHASES();
+        TRACE_PHASE("parse", filePath);
         auto[csv_file, full_column_names, header_line] = openFileWithHeader(filePath);
 
         std::vector<std::string> selected_column_names = extraColumns();
@@ -132,6 +135,7 @@ public:
             vertexIds.push_back(id);
         }
 
+        TRACE_PHASE("relabel", filePath);
         GrB_Vector id_to_index_ptr = nullptr;
         ok(LAGraph_dense_relabel(GrB_NULL, GrB_NULL, &id_to_index_ptr, vertexIds.data(), size(), GrB_NULL));
         idToIndexVec.reset(id_to_index_ptr);
@@ -152,6 +156,8 @@ struct EdgeCollection {
                                                             const std::vector<std::reference_wrapper<BaseVertexCollection>> &vertex_collection);
 
     virtual void importFile(std::vector<std::reference_wrapper<BaseVertexCollection>> const &vertex_collection) {
+        TRACE_PHASES();
+        TRACE_PHASE("parse", filePath);
         auto[csv_file, full_column_names, header_line] = openFileWithHeader(filePath);
 
         char const *src_prefix = ":START_ID(", *trg_prefix = ":END_ID(", *postfix = ")";
@@ -182,6 +188,7 @@ struct EdgeCollection {
         }
         edgeNumber = src_indices.size();
 
+        TRACE_PHASE("build", filePath);
         matrix = GB(GrB_Matrix_new, GrB_BOOL, src->size(), trg->size());
         ok(GrB_Matrix_build_BOOL(matrix.get(),
                                  src_indices.data(), trg_indices.data(),
@@ -197,6 +204,7 @@ struct TransposedEdgeCollection : public EdgeCollection {
             : EdgeCollection(base_edge.filePath, true), baseEdge(base_edge) {}
 
     void importFile(const std::vector<std::reference_wrapper<BaseVertexCollection>> &vertex_collection) override {
+        TRACE_SCOPE("transpose", filePath);
         src = baseEdge.trg;
         trg = baseEdge.src;
         edgeNumber = baseEdge.edgeNumber;
@@ -2,16 +2,34 @@
 #include <memory>
 #include <omp.h>
 #include "gb_utils.h"
+#include "query-executor.h"
 #include "query-parameters.h"
+#include "result-cache.h"
+#include "server.h"
+#include "trace.h"
 #include "utils.h"
 
+bool is_pipelined(BenchmarkParameters const &parameters) {
+    return parameters.PipelinedLoad &&
+           (parameters.Mode == BenchmarkParameters::File || parameters.Mode == BenchmarkParameters::Server);
+}
+
 std::unique_ptr<QueryInput> load(BenchmarkParameters const &parameters) {
     using namespace std::chrono;
     auto load_start = high_resolution_clock::now();
 
-    std::unique_ptr<QueryInput> input = std::make_unique<QueryInput>(parameters);
+    std::unique_ptr<QueryInput> input = std::make_unique<QueryInput>(parameters, is_pipelined(parameters));
+    if (is_pipelined(parameters)) {
+        // reported when the queries are done
+        input->loadInBackground(parameters.Query);
+        return input;
+    }
 
+    // stdout of the server is for the answers
+    if (parameters.Mode == BenchmarkParameters::Server)
+        ReportStream = &std::cerr;
     report_load(parameters, round<nanoseconds>(high_resolution_clock::now() - load_start));
+    ReportStream = &std::cout;
 
     return input;
 }
@@ -23,17 +41,46 @@ int main(int argc, char *argv[]) {
 
     if (parameters.ThreadsNum > 0)
         LAGraph_set_nthreads(parameters.ThreadsNum);
-    GlobalNThreads = LAGraph_get_nthreads();
+    ProcessNThreads = GlobalNThreads = LAGraph_get_nthreads();
     std::cerr << "Threads: " << GlobalNThreads << '/' << omp_get_max_threads() << std::endl;
+    if (parameters.AdaptiveThreads) {
+        calibrate_parallel_grain();
+        // GraphBLAS gives each thread a chunk of work, its default (64K) relates to our default grain (4096)
+        double chunk = 16.0 * ParallelGrain;
+        ok(GxB_Global_Option_set(GxB_CHUNK, chunk));
+        std::cerr << "GraphBLAS chunk: " << chunk << std::endl;
+    }
 
     auto queriesToRun = getQueriesWithParameters(parameters);
 
+    using namespace std::chrono;
+    auto load_start = high_resolution_clock::now();
     std::unique_ptr<QueryInput> input = load(parameters);
+    bool persist_results = !parameters.ResultCacheFile.empty() && input->caches.queryResults.enabled();
+    if (persist_results)
+        load_query_results(parameters, input->caches);
+
+    if (parameters.Mode == BenchmarkParameters::File && parameters.ConcurrentQueries > 1)
+        run_queries_concurrently(parameters, *input, queriesToRun);
+    else
+        for (auto const &task :queriesToRun) {
+            task(parameters, *input);
+        }
 
-    for (auto const &task :queriesToRun) {
-        task(parameters, *input);
+    // the whole load time, results of queries might have preceded it
+    if (is_pipelined(parameters) && parameters.Mode == BenchmarkParameters::File) {
+        input->waitForCollectionsOf(0);
+        report_load(parameters, round<nanoseconds>(high_resolution_clock::now() - load_start));
     }
 
+    if (parameters.Mode == BenchmarkParameters::Server)
+        run_server(parameters, *input);
+
+    if (persist_results)
+        save_query_results(parameters, input->caches);
+
+    write_trace(parameters.TraceFile);
+
     // Cleanup
     ok(LAGraph_finalize());
 
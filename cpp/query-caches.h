@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "gb_utils.h"
+#include "utils.h"
+#include "LruCache.h"
+
+/// Query3: pairs of local persons of a place reachable from each other in at most hopCount hops.
+/// Values are the distances, therefore the reachability for any smaller hop count can be selected.
+struct PlaceReachability {
+    int hopCount;
+    /// strictly lower triangular UINT8 matrix of distances
+    GBxx_Object_shared<GrB_Matrix> distances;
+    GrB_Index nvals;
+
+    size_t bytes() const {
+        // index and value of entries, row pointers of hypersparse matrices are usually negligible
+        return nvals * (sizeof(GrB_Index) + sizeof(uint8_t)) + sizeof(PlaceReachability);
+    }
+};
+
+/// Query4: members of a tag's forums ordered by closeness centrality (DESC) and person ID (ASC),
+/// the first k of them.
+struct TagRanking {
+    uint64_t k;
+    /// (closeness centrality, person ID)
+    std::vector<std::tuple<double, uint64_t>> ranking;
+
+    /// less than k persons have a closeness value, so the ranking answers any k
+    bool complete() const {
+        return ranking.size() < k;
+    }
+
+    size_t bytes() const {
+        return ranking.size() * sizeof(decltype(ranking)::value_type) + sizeof(TagRanking);
+    }
+};
+
+/// Result of a query line, for top-k queries up to k entries.
+struct QueryResult {
+    /// 0 if the query is not a top-k query
+    uint64_t k;
+    std::string result;
+    std::string comment;
+
+    size_t bytes() const {
+        return result.size() + comment.size() + sizeof(QueryResult);
+    }
+};
+
+/// Caches of intermediate results shared by queries running on the same input.
+struct QueryCaches {
+    /// key: place index
+    LruCache<GrB_Index, std::shared_ptr<PlaceReachability const>> placeReachability;
+    /// reachability of places is computed up to the largest hop count seen so far
+    std::atomic<int> placeReachabilityMaxHopCount{0};
+
+    /// key: tag index
+    LruCache<GrB_Index, std::shared_ptr<TagRanking const>> tagRanking;
+    /// rankings are computed up to the largest k seen so far
+    std::atomic<int> tagRankingMaxK{0};
+
+    /// key: query ID and parameters except k of top-k queries, see Query::resultCacheKey
+    LruCache<std::string, std::shared_ptr<QueryResult const>> queryResults;
+
+    explicit QueryCaches(BenchmarkParameters const &parameters)
+            : placeReachability(parameters.Q3CacheBudget,
+                                [](auto const &value) { return value->bytes(); }),
+              tagRanking(parameters.Q4CacheBudget,
+                         [](auto const &value) { return value->bytes(); }),
+              queryResults(parameters.ResultCacheBudget,
+                           [](auto const &value) { return value->bytes(); }) {}
+};
@@ -0,0 +1,88 @@
+#include "query-executor.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <iostream>
+#include <sstream>
+#include <omp.h>
+#include "gb_utils.h"
+
+namespace {
+
+/// Nearest-rank percentile of sorted values.
+double percentile(std::vector<double> const &sorted, double p) {
+    size_t rank = std::ceil(p * sorted.size());
+    return sorted[std::max<size_t>(rank, 1) - 1];
+}
+
+}
+
+void run_queries_concurrently(
+        BenchmarkParameters const &parameters, QueryInput const &input,
+        std::vector<std::function<std::string(BenchmarkParameters const &, QueryInput const &)>> const &queries) {
+    using namespace std::chrono;
+    if (queries.empty())
+        return;
+
+    int const concurrency = std::min<size_t>(parameters.ConcurrentQueries, queries.size());
+    int const query_threads = std::max(ProcessNThreads / concurrency, 1);
+
+    // parallel regions of the queries are nested into the executor, deeper ones stay inactive
+    int const max_active_levels = omp_get_max_active_levels();
+    omp_set_max_active_levels(2);
+    LAGraph_set_nthreads(query_threads);
+
+    std::vector<std::string> reports(queries.size());
+    std::vector<bool> finished(queries.size(), false);
+    std::vector<double> latencies(queries.size());
+    size_t next_report = 0;
+    std::exception_ptr error;
+
+    auto start = high_resolution_clock::now();
+#pragma omp parallel for num_threads(concurrency) schedule(dynamic, 1)
+    for (size_t i = 0; i < queries.size(); ++i) {
+        ThreadsScope threads{query_threads};
+        std::ostringstream report;
+        ReportStream = &report;
+
+        auto query_start = high_resolution_clock::now();
+        try {
+            queries[i](parameters, input);
+        } catch (...) {
+#pragma omp critical(query_executor_error)
+            if (!error)
+                error = std::current_exception();
+        }
+        latencies[i] = duration<double, std::micro>(high_resolution_clock::now() - query_start).count();
+        ReportStream = &std::cout;
+
+        // print the reports finished so far without a gap
+#pragma omp critical(query_executor_report)
+        {
+            reports[i] = report.str();
+            finished[i] = true;
+            for (; next_report < queries.size() && finished[next_report]; ++next_report) {
+                std::cout << reports[next_report];
+                reports[next_report] = {};
+            }
+            std::cout << std::flush;
+        }
+    }
+    auto runtime = duration<double>(high_resolution_clock::now() - start);
+
+    LAGraph_set_nthreads(ProcessNThreads);
+    omp_set_max_active_levels(max_active_levels);
+
+    if (error)
+        std::rethrow_exception(error);
+
+    std::sort(latencies.begin(), latencies.end());
+    std::cerr << "Concurrent queries: " << queries.size() << ", concurrency: " << concurrency
+              << ", threads per query: " << query_threads << ", time: " << round<microseconds>(runtime).count()
+              << " us, throughput: " << queries.size() / std::max(runtime.count(), 1e-9) << " queries/s"
+              << ", latency p50: " << percentile(latencies, 0.5) << " us, p90: " << percentile(latencies, 0.9)
+              << " us, p99: " << percentile(latencies, 0.99) << " us, max: " << latencies.back() << " us"
+              << std::endl;
+}
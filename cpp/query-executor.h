@@ -0,0 +1,16 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+#include "utils.h"
+#include "input.h"
+
+/// Runs parameters.ConcurrentQueries queries at once on the shared input. The threads of the process are split evenly:
+/// each query gets GlobalNThreads = ProcessNThreads / ConcurrentQueries for its own parallel regions and for GraphBLAS,
+/// whose thread count is process-wide but the same for every running query.
+/// Reports of the queries are buffered and printed in the original order, then the throughput and the latency
+/// percentiles go to stderr.
+void run_queries_concurrently(
+        BenchmarkParameters const &parameters, QueryInput const &input,
+        std::vector<std::function<std::string(BenchmarkParameters const &, QueryInput const &)>> const &queries);
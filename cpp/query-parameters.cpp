@@ -3,14 +3,19 @@
 #include "Query2.h"
 #include "Query3.h"
 #include "Query4.h"
+#include "Query4Batch.h"
+#include "query-scheduler.h"
+#include <algorithm>
 #include <stdexcept>
 #include <iostream>
 
 template<typename QueryType, typename... ParameterT>
-auto getQueryWrapper() {
+auto getQueryWrapper(int query_id) {
     return [=](ParameterT &&...query_parameters, std::optional<std::string> expected_result = std::nullopt)
             -> std::function<std::string(BenchmarkParameters const &, QueryInput const &)> {
         return [=](BenchmarkParameters const &benchmark_parameters, QueryInput const &input) -> std::string {
+            // collections might still be loading
+            input.waitForCollectionsOf(query_id);
             auto[result, comment] = QueryType(benchmark_parameters, std::make_tuple(query_parameters...), input)
                     .initial();
             if (expected_result) {
@@ -49,10 +54,10 @@ auto getQueryWrapper() {
 }
 
 auto getQueryWrappers() {
-    auto query1 = getQueryWrapper<Query1, uint64_t, uint64_t, int>();
-    auto query2 = getQueryWrapper<Query2, int, std::string>();
-    auto query3 = getQueryWrapper<Query3, int, int, std::string>();
-    auto query4 = getQueryWrapper<Query4, int, std::string>();
+    auto query1 = getQueryWrapper<Query1, uint64_t, uint64_t, int>(1);
+    auto query2 = getQueryWrapper<Query2, int, std::string>(2);
+    auto query3 = getQueryWrapper<Query3, int, int, std::string>(3);
+    auto query4 = getQueryWrapper<Query4, int, std::string>(4);
 
     return std::make_tuple(query1, query2, query3, query4);
 }
@@ -81,18 +86,54 @@ auto getQuery(char const *const *query_params, int query) {
     }
 }
 
-auto parseQueryParamsFile(BenchmarkParameters &benchmark_parameters) {
+constexpr size_t MaxQueryParamsCount = 3;
+
+/// Splits a parameter line like "query4(3, Tag)" in place into the parameters.
+/// \return query ID
+int splitQueryLine(char *line, char const *(&query_params)[MaxQueryParamsCount]) {
     using namespace std::literals;
+    std::string_view line_sv{line};
+
+    if (line_sv.length() < "query1()"sv.length() || line_sv.substr(0, "query"sv.length()) != "query"sv ||
+        line_sv["query1"sv.length()] != '(' || line_sv.back() != ')')
+        throw std::runtime_error("Invalid query line: " + std::string{line_sv});
+
+    int query = line["query"sv.length()] - '0';
+
+    size_t startIdx = "query1("sv.length();
+    // remove last parentheses
+    line[(line_sv.length() - ")"sv.length())] = '\0';
+
+    auto delimiter = ", "sv;
+    for (size_t i = 0; i < MaxQueryParamsCount; ++i) {
+        query_params[i] = line + startIdx;
+
+        size_t nextDelimiterIdx = line_sv.find(delimiter, startIdx);
+        if (nextDelimiterIdx == decltype(line_sv)::npos)
+            break;
+
+        line[nextDelimiterIdx] = '\0';
+
+        startIdx = nextDelimiterIdx + delimiter.length();
+    }
+
+    return query;
+}
+
+auto parseQueryParamsFile(BenchmarkParameters &benchmark_parameters) {
     std::vector<std::function<std::string(BenchmarkParameters const &, QueryInput const &)>> queries;
 
     std::optional<int> querySeen;
+    std::vector<Query4::ParameterType> query4Params;
+    auto scheduler = std::make_shared<QueryScheduler>();
     io::LineReader in(benchmark_parameters.QueryParamsFilePath);
     while (char *line = in.next_line()) {
-        constexpr size_t maxParamsCount = 3;
-        char const *queryParams[maxParamsCount] = {nullptr};
-        std::string_view line_sv{line};
+        if (*line == '\0')
+            continue;
+
+        char const *queryParams[MaxQueryParamsCount] = {nullptr};
+        int query = splitQueryLine(line, queryParams);
 
-        int query = line["query"sv.length()] - '0';
         // limit queries by command line argument
         if (benchmark_parameters.Query > 0 && benchmark_parameters.Query != query)
             continue;
@@ -102,37 +143,52 @@ auto parseQueryParamsFile(BenchmarkParameters &benchmark_parameters) {
         } else
             querySeen = query;
 
-        size_t startIdx = "query1("sv.length();
-        // remove last parentheses
-        line[(line_sv.length() - ")"sv.length())] = '\0';
-
-        auto delimiter = ", "sv;
-        for (size_t i = 0; i < maxParamsCount; ++i) {
-            queryParams[i] = line + startIdx;
-
-            size_t nextDelimiterIdx = line_sv.find(delimiter, startIdx);
-            if (nextDelimiterIdx == decltype(line_sv)::npos)
-                break;
-
-            line[nextDelimiterIdx] = '\0';
-
-            startIdx = nextDelimiterIdx + delimiter.length();
-        }
-
         queries.push_back(getQuery(queryParams, query));
+        if (benchmark_parameters.ScheduleQueries)
+            scheduler->add(query, queryParams, queries.back());
+        if (query == 4)
+            query4Params.emplace_back(std::stoi(queryParams[0]), queryParams[1]);
     }
     if (querySeen)
         benchmark_parameters.Query = querySeen.value();
 
+    if (benchmark_parameters.ScheduleQueries)
+        return decltype(queries){
+                [scheduler](BenchmarkParameters const &parameters, QueryInput const &input) -> std::string {
+                    return scheduler->run(parameters, input);
+                }};
+
+    if (benchmark_parameters.Q4Batch && benchmark_parameters.Query == 4)
+        return decltype(queries){
+                [query4Params](BenchmarkParameters const &parameters, QueryInput const &input) -> std::string {
+                    return std::get<0>(Query4Batch(parameters, query4Params, input).initial());
+                }};
+
     return queries;
 }
 
+std::function<std::string(BenchmarkParameters const &, QueryInput const &)> parseQueryLine(char *line) {
+    char const *queryParams[MaxQueryParamsCount] = {nullptr};
+    int query = splitQueryLine(line, queryParams);
+
+    size_t paramsCount = query == 1 || query == 3 ? 3 : 2;
+    size_t given = MaxQueryParamsCount - size_t(std::count(std::begin(queryParams), std::end(queryParams), nullptr));
+    if (given < paramsCount)
+        throw std::runtime_error("Query " + std::to_string(query) + " needs " + std::to_string(paramsCount) +
+                                 " parameters");
+
+    return getQuery(queryParams, query);
+}
+
 std::vector<std::function<std::string(BenchmarkParameters const &, QueryInput const &)>>
 getQueriesWithParameters(BenchmarkParameters &benchmark_parameters) {
     if (benchmark_parameters.Mode == BenchmarkParameters::Param) {
         return {getQuery(benchmark_parameters.QueryParams, benchmark_parameters.Query)};
     } else if (benchmark_parameters.Mode == BenchmarkParameters::File) {
         return parseQueryParamsFile(benchmark_parameters);
+    } else if (benchmark_parameters.Mode == BenchmarkParameters::Server) {
+        // queries are read by the server
+        return {};
     } else {
         // TEST CASES
         auto placeNameLookupTest = [](BenchmarkParameters const &, QueryInput const &input) -> std::string {
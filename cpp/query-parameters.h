@@ -8,3 +8,6 @@
 
 std::vector<std::function<std::string(BenchmarkParameters const &, QueryInput const &)>>
 getQueriesWithParameters(BenchmarkParameters &benchmark_parameters);
+
+/// Query of a parameter line like "query4(3, Tag)", the line is modified while parsing.
+std::function<std::string(BenchmarkParameters const &, QueryInput const &)> parseQueryLine(char *line);
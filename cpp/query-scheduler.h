@@ -0,0 +1,150 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "Query4Batch.h"
+#include "input.h"
+#include "utils.h"
+
+/// Runs the lines of a parameter file grouped by the sub-computation they share, instead of in file order:
+/// the threshold of Query1, the birthday limit of Query2, the place of Query3 and the tag of Query4.
+/// Groups run in the order of their first line, and the line needing the most of the shared result runs first
+/// in each group (largest hop count of Query3, largest k of Query4), so the caches of Query3 and Query4 answer
+/// the rest of the group. With Q4Batch, the Query4 lines run as one Query4Batch, ranking each tag once.
+/// Reports are buffered and printed in file order.
+class QueryScheduler {
+public:
+    using QueryFunction = std::function<std::string(BenchmarkParameters const &, QueryInput const &)>;
+
+private:
+    struct ScheduledQuery {
+        int query;
+        /// lines of a query with the same key share a sub-computation
+        std::string sharedKey;
+        /// lines with larger values reuse less of the results of the others
+        int reuseOrder;
+        QueryFunction function;
+        std::optional<Query4::ParameterType> query4Params;
+    };
+
+    std::vector<ScheduledQuery> queries;
+
+public:
+    void add(int query, char const *const *query_params, QueryFunction function) {
+        ScheduledQuery scheduled{query, "", 0, std::move(function), std::nullopt};
+        switch (query) {
+            case 1:
+                scheduled.sharedKey = query_params[2];
+                break;
+            case 2:
+                scheduled.sharedKey = query_params[1];
+                scheduled.reuseOrder = std::stoi(query_params[0]);
+                break;
+            case 3:
+                scheduled.sharedKey = query_params[2];
+                scheduled.reuseOrder = std::stoi(query_params[1]);
+                break;
+            case 4:
+                scheduled.sharedKey = query_params[1];
+                scheduled.reuseOrder = std::stoi(query_params[0]);
+                scheduled.query4Params.emplace(scheduled.reuseOrder, query_params[1]);
+                break;
+        }
+        queries.push_back(std::move(scheduled));
+    }
+
+    /// Runs the queries, then prints the number of groups and the cache hits gained to stderr.
+    /// \return results of the lines separated by newlines
+    std::string run(BenchmarkParameters const &parameters, QueryInput const &input) const {
+        using namespace std::chrono;
+        auto start = high_resolution_clock::now();
+
+        // groups in the order of their first line
+        std::map<std::tuple<int, std::string>, size_t> group_of_key;
+        std::vector<std::vector<size_t>> groups;
+        for (size_t i = 0; i < queries.size(); ++i) {
+            auto[it, inserted] = group_of_key.emplace(std::make_tuple(queries[i].query, queries[i].sharedKey),
+                                                      groups.size());
+            if (inserted)
+                groups.emplace_back();
+            groups[it->second].push_back(i);
+        }
+        for (auto &group : groups)
+            std::stable_sort(group.begin(), group.end(), [&](size_t a, size_t b) {
+                return queries[a].reuseOrder > queries[b].reuseOrder;
+            });
+
+        size_t q3_hits = input.caches.placeReachability.hits(), q4_hits = input.caches.tagRanking.hits();
+
+        std::vector<std::ostringstream> reports(queries.size());
+        std::vector<std::string> results(queries.size());
+        bool query4_batched = false;
+        for (auto const &group : groups) {
+            if (parameters.Q4Batch && queries[group.front()].query == 4) {
+                if (!query4_batched)
+                    run_query4_batch(parameters, input, groups, reports, results);
+                query4_batched = true;
+                continue;
+            }
+
+            for (size_t i : group) {
+                ReportStream = &reports[i];
+                try {
+                    results[i] = queries[i].function(parameters, input);
+                } catch (...) {
+                    ReportStream = &std::cout;
+                    throw;
+                }
+                ReportStream = &std::cout;
+            }
+        }
+
+        std::string joined_results;
+        for (size_t i = 0; i < queries.size(); ++i) {
+            std::cout << reports[i].str();
+            if (i != 0)
+                joined_results += '\n';
+            joined_results += results[i];
+        }
+        std::cout << std::flush;
+
+        auto runtime = round<microseconds>(high_resolution_clock::now() - start);
+        std::cerr << "Schedule: queries: " << queries.size() << ", groups: " << groups.size()
+                  << ", lines sharing the work of their group: " << queries.size() - groups.size()
+                  << ", Q3 cache hits: " << input.caches.placeReachability.hits() - q3_hits
+                  << ", Q4 cache hits: " << input.caches.tagRanking.hits() - q4_hits
+                  << ", time: " << runtime.count() << " us" << std::endl;
+
+        return joined_results;
+    }
+
+private:
+    /// Runs the Query4 lines of every group as one batch, reporting each line to its own stream.
+    void run_query4_batch(BenchmarkParameters const &parameters, QueryInput const &input,
+                          std::vector<std::vector<size_t>> const &groups,
+                          std::vector<std::ostringstream> &reports, std::vector<std::string> &results) const {
+        std::vector<size_t> lines;
+        std::vector<Query4::ParameterType> query4_params;
+        std::vector<std::ostream *> report_streams;
+        for (auto const &group : groups)
+            for (size_t i : group)
+                if (queries[i].query4Params) {
+                    lines.push_back(i);
+                    query4_params.push_back(*queries[i].query4Params);
+                    report_streams.push_back(&reports[i]);
+                }
+
+        std::string batch_results = std::get<0>(
+                Query4Batch(parameters, std::move(query4_params), input, std::move(report_streams)).initial());
+
+        std::istringstream batch_results_stream{batch_results};
+        for (size_t i : lines)
+            std::getline(batch_results_stream, results[i]);
+    }
+};
@@ -0,0 +1,101 @@
+#include "result-cache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+char const *const HeaderPrefix = "# sigmod2014pc query results ";
+char const FieldSeparator = '\t';
+
+/// 64-bit FNV-1a hash
+uint64_t fnv1a(std::string const &data, uint64_t hash = 14695981039346656037ull) {
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+}
+
+std::string dataset_fingerprint(std::string const &csv_path) {
+    namespace fs = std::filesystem;
+
+    std::vector<fs::path> files;
+    for (auto const &entry : fs::directory_iterator(csv_path))
+        if (entry.is_regular_file())
+            files.push_back(entry.path());
+    std::sort(files.begin(), files.end());
+
+    uint64_t hash = fnv1a("");
+    for (auto const &file : files) {
+        std::ostringstream description;
+        description << file.filename().string() << FieldSeparator << fs::file_size(file) << FieldSeparator
+                    << fs::last_write_time(file).time_since_epoch().count() << '\n';
+        hash = fnv1a(description.str(), hash);
+    }
+
+    std::ostringstream fingerprint;
+    fingerprint << std::hex << std::setw(16) << std::setfill('0') << hash;
+    return fingerprint.str();
+}
+
+void load_query_results(BenchmarkParameters const &parameters, QueryCaches &caches) {
+    std::ifstream in{parameters.ResultCacheFile};
+    if (!in)
+        return;
+
+    std::string header;
+    std::getline(in, header);
+    if (header != HeaderPrefix + dataset_fingerprint(parameters.CsvPath)) {
+        std::cerr << "Result cache: ignoring " << parameters.ResultCacheFile << " of another dataset" << std::endl;
+        return;
+    }
+
+    size_t loaded = 0;
+    for (std::string line; std::getline(in, line);) {
+        std::istringstream fields{line};
+        std::string key, k, result, comment;
+        if (!std::getline(fields, key, FieldSeparator) || !std::getline(fields, k, FieldSeparator) ||
+            !std::getline(fields, result, FieldSeparator))
+            throw std::runtime_error{"Invalid line in " + parameters.ResultCacheFile + ": " + line};
+        std::getline(fields, comment);
+
+        caches.queryResults.insert(key, std::make_shared<QueryResult const>(
+                QueryResult{std::stoull(k), std::move(result), std::move(comment)}));
+        ++loaded;
+    }
+    std::cerr << "Result cache: loaded " << loaded << " results from " << parameters.ResultCacheFile << std::endl;
+}
+
+void save_query_results(BenchmarkParameters const &parameters, QueryCaches const &caches) {
+    // replace the file at once, a concurrent run reads either the old or the new one
+    std::string temporary_path = parameters.ResultCacheFile + ".tmp";
+    {
+        std::ofstream out;
+        out.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+        out.open(temporary_path);
+
+        out << HeaderPrefix << dataset_fingerprint(parameters.CsvPath) << '\n';
+        caches.queryResults.forEach([&](std::string const &key, auto const &value) {
+            auto is_separator = [](char c) { return c == FieldSeparator || c == '\n'; };
+            if (std::any_of(key.begin(), key.end(), is_separator) ||
+                std::any_of(value->result.begin(), value->result.end(), is_separator) ||
+                std::any_of(value->comment.begin(), value->comment.end(), is_separator))
+                return;
+
+            out << key << FieldSeparator << value->k << FieldSeparator << value->result << FieldSeparator
+                << value->comment << '\n';
+        });
+    }
+
+    if (std::rename(temporary_path.c_str(), parameters.ResultCacheFile.c_str()) != 0)
+        throw std::runtime_error{"Cannot write " + parameters.ResultCacheFile};
+}
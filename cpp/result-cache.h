@@ -0,0 +1,14 @@
+#pragma once
+
+#include <string>
+#include "utils.h"
+#include "query-caches.h"
+
+/// Fingerprint of the dataset in csv_path from the names, sizes and modification times of its files.
+std::string dataset_fingerprint(std::string const &csv_path);
+
+/// Loads the results saved to parameters.ResultCacheFile into the cache if they belong to the same dataset.
+void load_query_results(BenchmarkParameters const &parameters, QueryCaches &caches);
+
+/// Saves the results of the cache to parameters.ResultCacheFile with the fingerprint of the dataset.
+void save_query_results(BenchmarkParameters const &parameters, QueryCaches const &caches);
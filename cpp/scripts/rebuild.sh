@@ -7,6 +7,9 @@ set -e -x
 BUILD_TYPE=${1:-${BUILD_TYPE:-Release}}
 BUILD_TYPE_LOWERCASE=$(echo $BUILD_TYPE | tr '[:upper:]' '[:lower:]')
 PRINT_RESULTS=${PRINT_RESULTS:-1}
+NATIVE_ARCH=${NATIVE_ARCH:-0}
+TRACE=${TRACE:-0}
+GB_PROFILE=${GB_PROFILE:-0}
 CPP_DIR=$(dirname "$0")/..
 CMAKE_BUILD_DIR=cmake-build-$BUILD_TYPE_LOWERCASE
 
@@ -14,5 +17,5 @@ cd "$CPP_DIR"
 rm -rf "$CMAKE_BUILD_DIR"
 mkdir "$CMAKE_BUILD_DIR"
 cd "$CMAKE_BUILD_DIR"
-cmake -DCMAKE_BUILD_TYPE=$BUILD_TYPE -DPRINT_RESULTS=$PRINT_RESULTS ..
+cmake -DCMAKE_BUILD_TYPE=$BUILD_TYPE -DPRINT_RESULTS=$PRINT_RESULTS -DNATIVE_ARCH=$NATIVE_ARCH -DTRACE=$TRACE -DGB_PROFILE=$GB_PROFILE ..
 make -j$(nproc)
@@ -0,0 +1,203 @@
+#include "server.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <system_error>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "query-parameters.h"
+
+namespace {
+
+/// Closes the file descriptor when going out of scope.
+class FileDescriptor {
+    int fd;
+
+public:
+    explicit FileDescriptor(int fd) : fd(fd) {
+        if (fd < 0)
+            throw std::system_error(errno, std::generic_category());
+    }
+
+    FileDescriptor(FileDescriptor const &) = delete;
+
+    FileDescriptor &operator=(FileDescriptor const &) = delete;
+
+    ~FileDescriptor() {
+        close(fd);
+    }
+
+    int get() const {
+        return fd;
+    }
+};
+
+/// Write end of the pipe becoming readable on SIGINT or SIGTERM in socket mode.
+int ShutdownPipe = -1;
+
+void request_shutdown(int) {
+    int saved_errno = errno;
+    char byte = 0;
+    // the pipe is readable from now on, a full pipe is readable already
+    if (write(ShutdownPipe, &byte, 1) < 0) {}
+    errno = saved_errno;
+}
+
+/// Installs request_shutdown for SIGINT and SIGTERM, restores the previous handlers when going out of scope.
+/// Any thread might get the signal, so it is passed through a pipe instead of interrupting the blocking calls.
+class ShutdownSignals {
+    struct sigaction previousInt{}, previousTerm{};
+
+public:
+    explicit ShutdownSignals(int pipe_write_fd) {
+        ShutdownPipe = pipe_write_fd;
+        struct sigaction action{};
+        action.sa_handler = request_shutdown;
+        sigemptyset(&action.sa_mask);
+        action.sa_flags = SA_RESTART;
+        sigaction(SIGINT, &action, &previousInt);
+        sigaction(SIGTERM, &action, &previousTerm);
+    }
+
+    ShutdownSignals(ShutdownSignals const &) = delete;
+
+    ShutdownSignals &operator=(ShutdownSignals const &) = delete;
+
+    ~ShutdownSignals() {
+        sigaction(SIGINT, &previousInt, nullptr);
+        sigaction(SIGTERM, &previousTerm, nullptr);
+        ShutdownPipe = -1;
+    }
+};
+
+/// Waits until fd is readable.
+/// \return false if shutdown_fd became readable first
+bool wait_readable(int fd, int shutdown_fd) {
+    pollfd fds[] = {{fd, POLLIN, 0}, {shutdown_fd, POLLIN, 0}};
+    for (;;) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            throw std::system_error(errno, std::generic_category(), "poll");
+        }
+        if (fds[1].revents != 0)
+            return false;
+        if (fds[0].revents != 0)
+            return true;
+    }
+}
+
+/// Result lines of the query of line written by report_result, or an error line.
+std::string answer(BenchmarkParameters const &parameters, QueryInput const &input, std::string line) {
+    // tolerate CRLF line endings
+    if (!line.empty() && line.back() == '\r')
+        line.pop_back();
+
+    std::ostringstream report;
+    ReportStream = &report;
+    try {
+        if (!line.empty())
+            parseQueryLine(line.data())(parameters, input);
+    } catch (std::exception const &e) {
+        std::string message = e.what();
+        std::replace(message.begin(), message.end(), '\n', ' ');
+        report << "error" << CSV_SEPARATOR << message << std::endl;
+    }
+    ReportStream = &std::cout;
+
+    return report.str();
+}
+
+/// \return false if the client is gone
+bool send_all(int client, std::string const &data) {
+    for (size_t sent = 0; sent < data.size();) {
+        // do not get killed by SIGPIPE if the client disconnected
+        ssize_t count = send(client, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (count < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        sent += count;
+    }
+    return true;
+}
+
+/// Answers the lines of client until it disconnects or shutdown is requested, a running query is finished.
+void serve_client(BenchmarkParameters const &parameters, QueryInput const &input, int client, int shutdown_fd) {
+    std::string buffer;
+    char chunk[4096];
+    for (;;) {
+        if (!wait_readable(client, shutdown_fd))
+            return;
+        ssize_t count = read(client, chunk, sizeof(chunk));
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count <= 0)
+            return;
+        buffer.append(chunk, count);
+
+        size_t line_end;
+        while ((line_end = buffer.find('\n')) != std::string::npos) {
+            std::string line = buffer.substr(0, line_end);
+            buffer.erase(0, line_end + 1);
+            if (!send_all(client, answer(parameters, input, std::move(line))))
+                return;
+        }
+    }
+}
+
+void serve_socket(BenchmarkParameters const &parameters, QueryInput const &input) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (parameters.SocketPath.size() >= sizeof(address.sun_path))
+        throw std::runtime_error{"Socket path is too long: " + parameters.SocketPath};
+    std::strcpy(address.sun_path, parameters.SocketPath.c_str());
+
+    FileDescriptor server{socket(AF_UNIX, SOCK_STREAM, 0)};
+    // remove the socket of a previous run
+    unlink(parameters.SocketPath.c_str());
+    if (bind(server.get(), reinterpret_cast<sockaddr const *>(&address), sizeof(address)) != 0 ||
+        listen(server.get(), SOMAXCONN) != 0)
+        throw std::system_error(errno, std::generic_category(), parameters.SocketPath);
+
+    int shutdown_pipe[2];
+    if (pipe(shutdown_pipe) != 0)
+        throw std::system_error(errno, std::generic_category(), "pipe");
+    FileDescriptor shutdown_read{shutdown_pipe[0]}, shutdown_write{shutdown_pipe[1]};
+    ShutdownSignals signals{shutdown_write.get()};
+    std::cerr << "Listening on " << parameters.SocketPath << ", SIGINT or SIGTERM stops the server" << std::endl;
+
+    while (wait_readable(server.get(), shutdown_read.get())) {
+        int client_fd = accept(server.get(), nullptr, nullptr);
+        if (client_fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            throw std::system_error(errno, std::generic_category(), "accept");
+        }
+
+        FileDescriptor client{client_fd};
+        serve_client(parameters, input, client.get(), shutdown_read.get());
+    }
+
+    unlink(parameters.SocketPath.c_str());
+    std::cerr << "Stopped listening on " << parameters.SocketPath << std::endl;
+}
+
+}
+
+void run_server(BenchmarkParameters const &parameters, QueryInput const &input) {
+    if (!parameters.SocketPath.empty()) {
+        serve_socket(parameters, input);
+        return;
+    }
+
+    for (std::string line; std::getline(std::cin, line);)
+        std::cout << answer(parameters, input, std::move(line)) << std::flush;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "utils.h"
+#include "input.h"
+
+/// Answers query lines (same syntax as the parameter files) with the loaded input until the end of the input stream,
+/// read from stdin or from the clients of the Unix domain socket at parameters.SocketPath one after the other.
+/// Each line is answered by the result lines of report_result (with the latency of the query)
+/// or by an "error,<message>" line.
+/// The socket is served until SIGINT or SIGTERM, then the function returns so that the caller saves its state.
+void run_server(BenchmarkParameters const &parameters, QueryInput const &input);
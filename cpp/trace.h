@@ -0,0 +1,154 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+
+// Phases of queries and of the load, recorded per thread and written as Chrome trace JSON
+// (chrome://tracing, Perfetto). Recording is compiled only with the TRACE CMake option,
+// otherwise the macros expand to nothing and their arguments are not evaluated.
+//
+// TRACE_SCOPE(name[, detail]): records the enclosing block.
+// TRACE_PHASES() and TRACE_PHASE(name[, detail]): records consecutive phases of a block, each phase lasts until
+// the next one or the end of the block.
+
+#ifdef TRACE
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+#include <unistd.h>
+
+struct TraceEvent {
+    std::string name, detail;
+    /// microseconds since TraceEpoch
+    double start, duration;
+};
+
+/// Events of a thread, kept after the thread exits.
+struct TraceBuffer {
+    int threadId;
+    std::mutex mutex;
+    std::vector<TraceEvent> events;
+};
+
+inline auto const TraceEpoch = std::chrono::steady_clock::now();
+inline std::mutex TraceBuffersMutex;
+inline std::vector<std::shared_ptr<TraceBuffer>> TraceBuffers;
+
+inline TraceBuffer &trace_buffer() {
+    thread_local std::shared_ptr<TraceBuffer> buffer = []() {
+        std::lock_guard<std::mutex> lock{TraceBuffersMutex};
+        auto new_buffer = std::make_shared<TraceBuffer>();
+        new_buffer->threadId = TraceBuffers.size();
+        TraceBuffers.push_back(new_buffer);
+        return new_buffer;
+    }();
+    return *buffer;
+}
+
+inline double trace_now() {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - TraceEpoch).count();
+}
+
+/// Records a complete event from its construction to its destruction.
+class TraceScope {
+    std::string name, detail;
+    double start;
+
+public:
+    explicit TraceScope(std::string name, std::string detail = "")
+            : name(std::move(name)), detail(std::move(detail)), start(trace_now()) {}
+
+    TraceScope(TraceScope const &) = delete;
+
+    TraceScope &operator=(TraceScope const &) = delete;
+
+    ~TraceScope() {
+        double end = trace_now();
+        TraceBuffer &buffer = trace_buffer();
+        std::lock_guard<std::mutex> lock{buffer.mutex};
+        buffer.events.push_back(TraceEvent{std::move(name), std::move(detail), start, end - start});
+    }
+};
+
+/// Consecutive phases of a block.
+class TracePhases {
+    std::optional<TraceScope> phase;
+
+public:
+    void next(std::string name, std::string detail = "") {
+        phase.reset();
+        phase.emplace(std::move(name), std::move(detail));
+    }
+};
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+#define TRACE_SCOPE(...) TraceScope TRACE_CONCAT(trace_scope_, __LINE__){__VA_ARGS__}
+#define TRACE_PHASES() TracePhases trace_phases
+#define TRACE_PHASE(...) trace_phases.next(__VA_ARGS__)
+
+inline std::string trace_json_string(std::string const &str) {
+    std::string escaped{'"'};
+    for (char c : str) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char code[8];
+            std::snprintf(code, sizeof(code), "\\u%04x", c);
+            escaped += code;
+        } else
+            escaped += c;
+    }
+    escaped += '"';
+    return escaped;
+}
+
+/// Writes the events recorded so far as Chrome trace JSON, does nothing if path is empty.
+inline void write_trace(std::string const &path) {
+    if (path.empty())
+        return;
+
+    std::ofstream out{path};
+    if (!out)
+        throw std::runtime_error{"Failed to open trace file at: " + path};
+
+    out << "{\"traceEvents\":[";
+    size_t event_count = 0;
+    std::lock_guard<std::mutex> buffers_lock{TraceBuffersMutex};
+    for (auto const &buffer : TraceBuffers) {
+        std::lock_guard<std::mutex> lock{buffer->mutex};
+        for (TraceEvent const &event : buffer->events) {
+            out << (event_count++ == 0 ? "\n" : ",\n")
+                << "{\"name\":" << trace_json_string(event.name)
+                << ",\"ph\":\"X\",\"pid\":" << getpid() << ",\"tid\":" << buffer->threadId
+                << ",\"ts\":" << std::fixed << event.start << ",\"dur\":" << event.duration;
+            if (!event.detail.empty())
+                out << ",\"args\":{\"detail\":" << trace_json_string(event.detail) << '}';
+            out << '}';
+        }
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\"}" << std::endl;
+
+    std::cerr << "Trace: " << event_count << " events of " << TraceBuffers.size() << " threads written to "
+              << path << std::endl;
+}
+
+#else
+
+#define TRACE_SCOPE(...)
+#define TRACE_PHASES()
+#define TRACE_PHASE(...)
+
+inline void write_trace(std::string const &path) {
+    if (!path.empty())
+        std::cerr << "Trace is not written to " << path << ", build with -DTRACE=ON to record it" << std::endl;
+}
+
+#endif
@@ -2,6 +2,10 @@
 #include <chrono>
 #include <optional>
 #include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
 
 #include "utils.h"
 #include "BaseQuery.h"
@@ -18,12 +22,21 @@ std::string getenv_string(const char *name, const std::optional<std::string> &de
         throw std::runtime_error{"Missing environmental variable: "s + name};
 }
 
+thread_local std::ostream *ReportStream = &std::cout;
+
 BenchmarkParameters parse_benchmark_params(int argc, char *argv[]) {
     using namespace std::literals;
 
     BenchmarkParameters params;
 
-    if (argc >= 4) {
+    if (argc >= 3 && argv[2] == "SERVER"sv) {
+        params.CsvPath = argv[1];
+        params.Mode = BenchmarkParameters::Server;
+        // load the inputs of all queries
+        params.Query = 0;
+        if (argc >= 4)
+            params.SocketPath = argv[3];
+    } else if (argc >= 4) {
         params.CsvPath = argv[1];
         if (argv[2] == "PARAM"sv) {
             params.Mode = BenchmarkParameters::Param;
@@ -39,7 +52,8 @@ BenchmarkParameters parse_benchmark_params(int argc, char *argv[]) {
         } else
             throw std::runtime_error(
                     "Command line arguments should be: <CSV_FOLDER> PARAM <QUERY_ID> <QUERY_PARAMS>...\n"
-                    "or <CSV_FOLDER> FILE <QUERY_PARAMS_TXT_FILE> <OPTIONAL_QUERY_ID>");
+                    "or <CSV_FOLDER> FILE <QUERY_PARAMS_TXT_FILE> <OPTIONAL_QUERY_ID>\n"
+                    "or <CSV_FOLDER> SERVER <OPTIONAL_SOCKET_PATH>");
     } else {
         params.Mode = BenchmarkParameters::Test;
         params.CsvPath = getenv_string("CsvPath", "../../csvs/o1k/");
@@ -61,20 +75,109 @@ BenchmarkParameters parse_benchmark_params(int argc, char *argv[]) {
     if (ThreadsNum_str)
         params.ThreadsNum = std::stoi(ThreadsNum_str);
 
+    params.PrintStats = getenv_string("PrintStats", "0") != "0";
+    params.Q3HubThreshold = std::stoull(getenv_string("Q3HubThreshold", std::to_string(params.Q3HubThreshold)));
+    params.Q3MemoryBudget = std::stoull(getenv_string("Q3MemoryBudget", std::to_string(params.Q3MemoryBudget)));
+    params.Q3CacheBudget = std::stoull(getenv_string("Q3CacheBudget", std::to_string(params.Q3CacheBudget)));
+    params.CcvKernel = getenv_string("CcvKernel", params.CcvKernel);
+    if (params.CcvKernel != "graphblas" && params.CcvKernel != "bool" && params.CcvKernel != "native" &&
+        params.CcvKernel != "auto")
+        throw std::runtime_error{"CcvKernel should be graphblas, bool, native or auto, got: " + params.CcvKernel};
+    params.CcvBoolMaxSize = std::stoull(getenv_string("CcvBoolMaxSize", std::to_string(params.CcvBoolMaxSize)));
+    params.CcvLaneBits = std::stoull(getenv_string("CcvLaneBits", std::to_string(params.CcvLaneBits)));
+    if (params.CcvLaneBits != 0 && params.CcvLaneBits != 64 && params.CcvLaneBits != 128 &&
+        params.CcvLaneBits != 256 && params.CcvLaneBits != 512)
+        throw std::runtime_error{"CcvLaneBits should be 0, 64, 128, 256 or 512, got: " +
+                                 std::to_string(params.CcvLaneBits)};
+    params.CcvBatchSize = std::stoull(getenv_string("CcvBatchSize", std::to_string(params.CcvBatchSize)));
+    params.Q4CacheBudget = std::stoull(getenv_string("Q4CacheBudget", std::to_string(params.Q4CacheBudget)));
+    params.Q4ApproximateError = std::stod(getenv_string("Q4ApproximateError",
+                                                        std::to_string(params.Q4ApproximateError)));
+    if (params.Q4ApproximateError < 0)
+        throw std::runtime_error{"Q4ApproximateError should not be negative, got: " +
+                                 std::to_string(params.Q4ApproximateError)};
+    params.Q4ApproximateConfidence = std::stod(getenv_string("Q4ApproximateConfidence",
+                                                             std::to_string(params.Q4ApproximateConfidence)));
+    if (params.Q4ApproximateConfidence <= 0 || params.Q4ApproximateConfidence >= 1)
+        throw std::runtime_error{"Q4ApproximateConfidence should be between 0 and 1, got: " +
+                                 std::to_string(params.Q4ApproximateConfidence)};
+    params.Q4Batch = getenv_string("Q4Batch", "0") != "0";
+    params.ResultCacheBudget = std::stoull(getenv_string("ResultCacheBudget",
+                                                         std::to_string(params.ResultCacheBudget)));
+    params.ResultCacheFile = getenv_string("ResultCacheFile", "");
+    params.TraceFile = getenv_string("TraceFile", "");
+    params.QueryTimeout = std::stoull(getenv_string("QueryTimeout", std::to_string(params.QueryTimeout)));
+    params.PipelinedLoad = getenv_string("PipelinedLoad", "0") != "0";
+    params.AdaptiveThreads = getenv_string("AdaptiveThreads", "0") != "0";
+    params.ScheduleQueries = getenv_string("ScheduleQueries", "0") != "0";
+    params.ConcurrentQueries = std::stoi(getenv_string("ConcurrentQueries", std::to_string(params.ConcurrentQueries)));
+    if (params.ConcurrentQueries < 1)
+        throw std::runtime_error{"ConcurrentQueries should be positive, got: " +
+                                 std::to_string(params.ConcurrentQueries)};
+
     return params;
 }
 
-int GlobalNThreads;
+int ProcessNThreads;
+thread_local int GlobalNThreads = ProcessNThreads;
+size_t ParallelGrain = 4096;
+thread_local std::chrono::steady_clock::time_point QueryDeadline = std::chrono::steady_clock::time_point::max();
+
+int phase_threads(BenchmarkParameters const &parameters, char const *phase, size_t work) {
+    if (!parameters.AdaptiveThreads)
+        return GlobalNThreads;
+
+    int nthreads = threads_for(work);
+    if (parameters.PrintStats)
+        std::cerr << "Threads of " << phase << ": work: " << work << ", threads: " << nthreads << '/'
+                  << GlobalNThreads << std::endl;
+    return nthreads;
+}
+
+void calibrate_parallel_grain() {
+    using namespace std::chrono;
+    int nthreads = std::max(GlobalNThreads, 1);
+
+    // median of empty parallel regions
+    std::vector<double> fork_join_ns(101);
+    for (double &ns : fork_join_ns) {
+        auto start = high_resolution_clock::now();
+#pragma omp parallel num_threads(nthreads)
+        {
+        }
+        ns = duration<double, std::nano>(high_resolution_clock::now() - start).count();
+    }
+    std::nth_element(fork_join_ns.begin(), fork_join_ns.begin() + fork_join_ns.size() / 2, fork_join_ns.end());
+    double fork_join = fork_join_ns[fork_join_ns.size() / 2];
+
+    // fastest sequential fill, like array_of_indices
+    std::vector<uint64_t> values(1 << 20);
+    double element = std::numeric_limits<double>::max();
+    for (int run = 0; run < 5; ++run) {
+        auto start = high_resolution_clock::now();
+        for (size_t i = 0; i < values.size(); ++i)
+            values[i] = i;
+        element = std::min(element, duration<double, std::nano>(high_resolution_clock::now() - start).count() /
+                                    values.size());
+    }
+    // keep the loop
+    volatile uint64_t sink = values[fork_join_ns.size()];
+    (void) sink;
+
+    ParallelGrain = std::clamp<size_t>(std::ceil(4 * fork_join / std::max(element, 1e-3)), 64, 1 << 22);
+    std::cerr << "Adaptive threads: fork/join of " << nthreads << " threads: " << fork_join << " ns, loop element: "
+              << element << " ns, grain: " << ParallelGrain << " elements" << std::endl;
+}
 
 void report_load(const BenchmarkParameters &parameters, std::chrono::nanoseconds runtime) {
     using namespace std::chrono;
 
-    std::cout
+    (*ReportStream)
             << 'q' << parameters.Query << CSV_SEPARATOR
             << round<microseconds>(runtime).count() << CSV_SEPARATOR;
 
     if (parameters.Mode != BenchmarkParameters::Param)
-        std::cout << std::endl;
+        (*ReportStream) << std::endl;
 }
 
 void report_result(BaseQuery const &query, BenchmarkParameters const &parameters, std::chrono::nanoseconds runtime,
@@ -82,19 +185,25 @@ void report_result(BaseQuery const &query, BenchmarkParameters const &parameters
     using namespace std::chrono;
 
     if (parameters.Mode != BenchmarkParameters::Param)
-        std::cout
+        (*ReportStream)
                 << 'q' << query.getQueryId() << CSV_SEPARATOR
                 << CSV_SEPARATOR;
 
     auto const&[result, comment] = result_tuple;
 
-    std::cout
-            << round<microseconds>(runtime).count()
-            #if !defined(NDEBUG) || defined(PRINT_RESULTS)
-            << CSV_SEPARATOR << result
-            << CSV_SEPARATOR << comment
-            #endif
-            << std::endl;
+#if !defined(NDEBUG) || defined(PRINT_RESULTS)
+    constexpr bool print_results = true;
+#else
+    constexpr bool print_results = false;
+#endif
+
+    (*ReportStream) << round<microseconds>(runtime).count();
+    // results are the answers of the server
+    if (print_results || parameters.Mode == BenchmarkParameters::Server)
+        (*ReportStream)
+                << CSV_SEPARATOR << result
+                << CSV_SEPARATOR << comment;
+    (*ReportStream) << std::endl;
 }
 
 time_t parseTimestamp(const char *timestamp_str, const char *timestamp_format) {
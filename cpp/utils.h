@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <stdexcept>
 #include <vector>
 #include <chrono>
@@ -13,7 +14,8 @@ struct BenchmarkParameters {
     enum RunMode {
         Test,
         Param,
-        File
+        File,
+        Server
     };
 
     std::string CsvPath;
@@ -25,13 +27,137 @@ struct BenchmarkParameters {
     RunMode Mode = Test;
     char const *const *QueryParams = nullptr;
     std::string QueryParamsFilePath;
+    /// Server mode: Unix domain socket to listen on (empty: stdin and stdout)
+    std::string SocketPath;
     int QueryParamsNum = 0;
     int ThreadsNum = 0;
+    /// print statistics of the algorithms to stderr
+    bool PrintStats = false;
+    /// Query3: meeting vertices reached by at least this many persons are enumerated with bitsets (0: disabled)
+    uint64_t Q3HubThreshold = 1000;
+    /// Query3: traverse from source persons in batches fitting into this many bytes (0: unlimited)
+    uint64_t Q3MemoryBudget = 0;
+    /// Query3: byte budget of the per-place reachability cache (0: disabled)
+    uint64_t Q3CacheBudget = 0;
+    /// Query4: closeness centrality kernel, "graphblas", "bool", "native" or "auto"
+    std::string CcvKernel = "auto";
+    /// Query4: the "auto" kernel uses boolean matrices up to this many members
+    uint64_t CcvBoolMaxSize = 64;
+    /// Query4: sources per batch of the native kernel: 64, 128, 256 or 512 (0: chosen by subgraph size)
+    uint64_t CcvLaneBits = 0;
+    /// Query4: sources per parallel batch of the graphblas kernel (0: all at once)
+    uint64_t CcvBatchSize = 0;
+    /// Query4: byte budget of the per-tag ranking cache (0: disabled)
+    uint64_t Q4CacheBudget = 0;
+    /// Query4: if positive, closeness centrality is estimated by sampling with this error relative to the diameter,
+    /// then the candidates of the top k are verified exactly
+    double Q4ApproximateError = 0;
+    /// Query4: probability of the estimates being within the error
+    double Q4ApproximateConfidence = 0.99;
+    /// Query4: run the lines of a Query4 parameter file as one batch
+    bool Q4Batch = false;
+    /// byte budget of the cache of query results (0: disabled)
+    uint64_t ResultCacheBudget = 0;
+    /// file the cache of query results is loaded from and saved to (empty: not persisted)
+    std::string ResultCacheFile;
+    /// queries running longer than this many milliseconds are aborted and reported as "timeout" (0: no limit)
+    uint64_t QueryTimeout = 0;
+    /// file the phases of the run are written to as Chrome trace JSON if built with TRACE (empty: not written)
+    std::string TraceFile;
+    /// File and server modes: load the collections in the background and start each query once its own are loaded
+    bool PipelinedLoad = false;
+    /// pick thread counts by work size with a grain calibrated at startup, see threads_for
+    bool AdaptiveThreads = false;
+    /// File mode: number of queries running at once, sharing the threads
+    int ConcurrentQueries = 1;
+    /// File mode: run the lines grouped by shared sub-computations, reporting them in file order
+    bool ScheduleQueries = false;
 };
 
 BenchmarkParameters parse_benchmark_params(int argc, char *argv[]);
 
-extern int GlobalNThreads;
+/// Threads of the process
+extern int ProcessNThreads;
+/// Threads available to the query of the calling thread, initially ProcessNThreads.
+/// The threads of a parallel region start from ProcessNThreads too, so regions calling code which reads it set their
+/// share with ThreadsScope.
+extern thread_local int GlobalNThreads;
+
+/// Elements of a simple loop worth running on an additional thread, calibrated at startup with AdaptiveThreads
+extern size_t ParallelGrain;
+
+/// Threads for a parallel loop over work elements: one per ParallelGrain elements, at most GlobalNThreads.
+inline int threads_for(size_t work) {
+    int nthreads = GlobalNThreads;
+    nthreads = std::min<size_t>(work / ParallelGrain, nthreads);
+    return std::max(nthreads, 1);
+}
+
+/// Threads of a query phase processing about work elements: threads_for with AdaptiveThreads
+/// (logged with PrintStats), GlobalNThreads otherwise.
+int phase_threads(BenchmarkParameters const &parameters, char const *phase, size_t work);
+
+/// Sets ParallelGrain, so the fork/join overhead of a parallel region is at most a quarter of the work of a thread,
+/// measured with GlobalNThreads threads.
+void calibrate_parallel_grain();
+
+/// Sets GlobalNThreads of the calling thread until the end of the scope.
+class ThreadsScope {
+    int previousNThreads;
+
+public:
+    explicit ThreadsScope(int nthreads) : previousNThreads(GlobalNThreads) {
+        GlobalNThreads = nthreads;
+    }
+
+    ThreadsScope(ThreadsScope const &) = delete;
+
+    ThreadsScope &operator=(ThreadsScope const &) = delete;
+
+    ~ThreadsScope() {
+        GlobalNThreads = previousNThreads;
+    }
+};
+
+/// Thrown when the query of the thread runs past its deadline.
+struct QueryTimeoutError : public std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+/// Deadline of the query of the calling thread, checked between the steps of long computations
+extern thread_local std::chrono::steady_clock::time_point QueryDeadline;
+
+inline bool deadline_passed() {
+    return QueryDeadline != std::chrono::steady_clock::time_point::max() &&
+           std::chrono::steady_clock::now() > QueryDeadline;
+}
+
+/// \throws QueryTimeoutError if the deadline of the query has passed
+inline void check_deadline() {
+    if (deadline_passed())
+        throw QueryTimeoutError{"Query timed out"};
+}
+
+/// Sets QueryDeadline of the calling thread until the end of the scope, e.g. in the threads of a parallel region.
+class DeadlineScope {
+    std::chrono::steady_clock::time_point previousDeadline;
+
+public:
+    explicit DeadlineScope(std::chrono::steady_clock::time_point deadline) : previousDeadline(QueryDeadline) {
+        QueryDeadline = deadline;
+    }
+
+    DeadlineScope(DeadlineScope const &) = delete;
+
+    DeadlineScope &operator=(DeadlineScope const &) = delete;
+
+    ~DeadlineScope() {
+        QueryDeadline = previousDeadline;
+    }
+};
+
+/// Stream of report_load and report_result of the thread, e.g. a client connection in server mode
+extern thread_local std::ostream *ReportStream;
 
 void report_load(BenchmarkParameters const &parameters, std::chrono::nanoseconds runtime);
 